@@ -0,0 +1,400 @@
+ /**
+ **************************************************************
+ * @file host/asc_gantry_emu.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Host (Linux) stand-in for the ASC gantry. Consumes the
+ * exact 32 byte hamming encoded frames sent by
+ * s4741858TaskTxradioControl, simulates axis motion and vacuum
+ * timing, and reports throughput, latency and rejected frames.
+ ***************************************************************
+ * BUILD (from this directory)
+ ***************************************************************
+ * gcc -O2 -I.. -o asc_gantry_emu asc_gantry_emu.c ../s4741858_hamming.c
+ ***************************************************************
+ * INPUT - one frame per line, '#' lines ignored
+ ***************************************************************
+ * <air tick ms> <64 hex chars - encoded frame as sent to nrf>
+ * Lines that are not 64 hex digits are rejected as hamming errors.
+ *
+ * traces/gantry_session.txt is a short sample session - JOIN,
+ * moves, vacuum, a scheduled (EXEC) move, a corrected bit error
+ * and three bad frames:
+ * ./asc_gantry_emu -v traces/gantry_session.txt
+ *
+ * usage: asc_gantry_emu [-v] [-x speed] [-y speed] [-z speed]
+ *                       [-r speed] [-s settle ms] [-o overhead ms]
+ *                       [file]
+ ***************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "s4741858_hamming.h"
+
+/* Frame Format (see s4741858_txradio.h / s4741858_ascsys.h) -----------------*/
+#define FRAME_SIZE      16
+#define ENCODED_SIZE    32
+#define JOIN_TYPE       0x20
+#define SYNC_TYPE       0x21
+#define XYZ_TYPE        0x22
+#define ROT_TYPE        0x23
+#define VAC_TYPE        0x24
+#define EXEC_TYPE       0x25
+#define TIMESTAMP_INDEX 9
+
+#define MAX_COMMANDS    100000
+
+/* Rejection Reasons -----------------------------------------*/
+#define REJECT_HAMMING  0 // uncorrectable bit errors
+#define REJECT_TYPE     1 // unknown packet type
+#define REJECT_SENDER   2 // not our controller
+#define REJECT_PAYLOAD  3 // bad tag / digits / range
+#define REJECT_COUNT    4
+
+static const char *rejectNames[REJECT_COUNT] = {"hamming", "type", "sender", "payload"};
+static const uint8_t senderAddress[4] = {0x47, 0x41, 0x85, 0x89};
+
+// Gantry configuration - defaults match s4741858_motion.h
+static int speedX = 100;   // units per second
+static int speedY = 100;
+static int speedZ = 50;
+static int speedRot = 90;  // degrees per second
+static int vacSettle = 300; // ms
+static int overhead = 40;  // ms per command
+static int verbose = 0;
+
+// Simulated gantry
+typedef struct {
+	int x;
+	int y;
+	int z;
+	int angle;
+	int vacuum;
+	double busyUntil;  // host ms the current command finishes
+	int joined;
+	double clockOffset; // host ms - controller ms
+	int execPending;    // EXEC seen, applies to next command
+	double execAt;      // host ms
+} Gantry;
+
+// Run statistics
+static double latency[MAX_COMMANDS]; // arrival to done, ms
+static double lateness[MAX_COMMANDS]; // start - requested (EXEC only)
+static int commands = 0;
+static int scheduled = 0;
+static int corrected = 0;
+static int rejected[REJECT_COUNT];
+static double firstArrival = -1;
+static double lastDone = 0;
+
+/*
+ * Decodes one 32 byte frame. Each received byte is matched to the nearest
+ * codeword of the mylib hamming encoder (the one the controller sends with),
+ * one differing bit is a corrected error, more than one is uncorrectable.
+ * @return 0 ok, -1 uncorrectable
+ */
+static int decode_frame(const uint8_t encoded[ENCODED_SIZE], uint8_t frame[FRAME_SIZE]) {
+
+	static uint8_t codeword[16];
+	static int built = 0;
+
+	if (!built) {
+		for (int n = 0; n < 16; n++) {
+			codeword[n] = s4741858_lib_hamming_byte_encoder(n) & 0xFF;
+		}
+		built = 1;
+	}
+
+	for (int i = 0; i < ENCODED_SIZE; i++) {
+		int best = 0;
+		int bestBits = 9;
+
+		for (int n = 0; n < 16; n++) {
+			int bits = __builtin_popcount(codeword[n] ^ encoded[i]);
+			if (bits < bestBits) {
+				bestBits = bits;
+				best = n;
+			}
+		}
+
+		if (bestBits > 1) {
+			return -1;
+		}
+		corrected += bestBits;
+
+		// low nibble first, as packed by ENCODE_STATE
+		if (i % 2 == 0) {
+			frame[i / 2] = best;
+		} else {
+			frame[i / 2] |= best << 4;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Converts the hex text of one encoded frame. Both characters of each
+ * byte are checked - "%2x" alone also takes a single digit or a sign.
+ * @return 0 ok, -1 wrong length or not hex
+ */
+static int parse_hex(const char *hex, uint8_t encoded[ENCODED_SIZE]) {
+
+	if (strlen(hex) != 2 * ENCODED_SIZE) {
+		return -1;
+	}
+
+	for (int i = 0; i < ENCODED_SIZE; i++) {
+		unsigned int byte;
+
+		if (!isxdigit((unsigned char) hex[i * 2]) || !isxdigit((unsigned char) hex[i * 2 + 1]) ||
+				sscanf(&hex[i * 2], "%2x", &byte) != 1) {
+			return -1;
+		}
+		encoded[i] = byte;
+	}
+
+	return 0;
+}
+
+/*
+ * Parses n ASCII digits.
+ * @return value or -1 if any byte is not a digit
+ */
+static int parse_digits(const uint8_t *text, int n) {
+
+	int value = 0;
+
+	for (int i = 0; i < n; i++) {
+		if (text[i] < '0' || text[i] > '9') {
+			return -1;
+		}
+		value = value * 10 + (text[i] - '0');
+	}
+
+	return value;
+}
+
+static uint32_t get_tick(const uint8_t frame[FRAME_SIZE]) {
+
+	uint32_t tick = 0;
+
+	for (int i = 0; i < 4; i++) {
+		tick |= (uint32_t) frame[TIMESTAMP_INDEX + i] << (8 * i);
+	}
+
+	return tick;
+}
+
+static double axis_ms(int from, int to, int speed) {
+	return (double) abs(to - from) * 1000.0 / speed;
+}
+
+/*
+ * Starts a command on the gantry - after the current one, and no
+ * earlier than its EXEC tick if scheduled.
+ */
+static void run_command(Gantry *g, double arrival, int x, int y, int z, int angle, int vacuum, double settle) {
+
+	double start = (g->busyUntil > arrival) ? g->busyUntil : arrival;
+	double duration = axis_ms(g->x, x, speedX);
+	double axis;
+
+	if (g->execPending) {
+		if (g->execAt > start) {
+			start = g->execAt;
+		}
+		if (scheduled < MAX_COMMANDS) {
+			lateness[scheduled++] = start - g->execAt;
+		}
+		g->execPending = 0;
+	}
+
+	axis = axis_ms(g->y, y, speedY);
+	duration = (axis > duration) ? axis : duration;
+	axis = axis_ms(g->z, z, speedZ);
+	duration = (axis > duration) ? axis : duration;
+	axis = axis_ms(g->angle, angle, speedRot);
+	duration = (axis > duration) ? axis : duration;
+
+	g->busyUntil = start + duration + settle + overhead;
+	g->x = x;
+	g->y = y;
+	g->z = z;
+	g->angle = angle;
+	g->vacuum = vacuum;
+
+	if (commands < MAX_COMMANDS) {
+		latency[commands] = g->busyUntil - arrival;
+	}
+	commands++;
+	lastDone = g->busyUntil;
+
+	if (verbose) {
+		printf("%10.1f start %10.1f done %10.1f  X%3d Y%3d Z%2d A%3d V%d\n",
+				arrival, start, g->busyUntil, x, y, z, angle, vacuum);
+	}
+}
+
+/*
+ * Handles one decoded frame.
+ * @return -1 if accepted, else REJECT_* reason
+ */
+static int handle_frame(Gantry *g, double arrival, const uint8_t frame[FRAME_SIZE]) {
+
+	int x, y, z, angle;
+
+	if (memcmp(&frame[1], senderAddress, 4) != 0) {
+		return REJECT_SENDER;
+	}
+
+	switch (frame[0]) {
+
+		case JOIN_TYPE:
+		case SYNC_TYPE:
+			if (memcmp(&frame[5], (frame[0] == JOIN_TYPE) ? "JOIN" : "SYNC", 4) != 0) {
+				return REJECT_PAYLOAD;
+			}
+			g->clockOffset = arrival - get_tick(frame);
+			g->joined = 1;
+			return -1;
+
+		case EXEC_TYPE:
+			if (memcmp(&frame[5], "EXEC", 4) != 0 || !g->joined) {
+				return REJECT_PAYLOAD;
+			}
+			g->execAt = get_tick(frame) + g->clockOffset;
+			g->execPending = 1;
+			return -1;
+
+		case XYZ_TYPE:
+			x = parse_digits(&frame[8], 3);
+			y = parse_digits(&frame[11], 3);
+			z = parse_digits(&frame[14], 2);
+			if (memcmp(&frame[5], "XYZ", 3) != 0 || x < 0 || x > 150 || y < 0 || y > 150 || z < 0) {
+				return REJECT_PAYLOAD;
+			}
+			run_command(g, arrival, x, y, z, g->angle, g->vacuum, 0);
+			return -1;
+
+		case ROT_TYPE:
+			angle = parse_digits(&frame[8], 3);
+			if (memcmp(&frame[5], "ROT", 3) != 0 || angle < 0 || angle > 180) {
+				return REJECT_PAYLOAD;
+			}
+			run_command(g, arrival, g->x, g->y, g->z, angle, g->vacuum, 0);
+			return -1;
+
+		case VAC_TYPE:
+			if (memcmp(&frame[5], "VON", 3) == 0) {
+				run_command(g, arrival, g->x, g->y, g->z, g->angle, 1, vacSettle);
+			} else if (memcmp(&frame[5], "VOFF", 4) == 0) {
+				run_command(g, arrival, g->x, g->y, g->z, g->angle, 0, vacSettle);
+			} else {
+				return REJECT_PAYLOAD;
+			}
+			return -1;
+	}
+
+	return REJECT_TYPE;
+}
+
+static int compare_double(const void *a, const void *b) {
+
+	double da = *(const double *) a;
+	double db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+static void print_percentiles(const char *name, double *values, int count) {
+
+	if (count == 0) {
+		return;
+	}
+
+	qsort(values, count, sizeof(double), compare_double);
+	printf("%-16s p50 %8.1f  p95 %8.1f  p99 %8.1f  max %8.1f ms\n", name,
+			values[count * 50 / 100], values[count * 95 / 100], values[count * 99 / 100], values[count - 1]);
+}
+
+int main(int argc, char **argv) {
+
+	Gantry gantry = {0};
+	FILE *in = stdin;
+	char line[256];
+	int frames = 0;
+	int totalRejected = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vx:y:z:r:s:o:")) != -1) {
+		switch (opt) {
+			case 'v': verbose = 1; break;
+			case 'x': speedX = atoi(optarg); break;
+			case 'y': speedY = atoi(optarg); break;
+			case 'z': speedZ = atoi(optarg); break;
+			case 'r': speedRot = atoi(optarg); break;
+			case 's': vacSettle = atoi(optarg); break;
+			case 'o': overhead = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-v] [-x|-y|-z|-r speed] [-s settle] [-o overhead] [file]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	if (optind < argc && (in = fopen(argv[optind], "r")) == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		uint8_t encoded[ENCODED_SIZE];
+		uint8_t frame[FRAME_SIZE];
+		char hex[2 * ENCODED_SIZE + 1];
+		double arrival;
+		int reason;
+
+		if (line[0] == '#' || sscanf(line, "%lf %64s", &arrival, hex) != 2) {
+			continue;
+		}
+
+		frames++;
+		if (firstArrival < 0) {
+			firstArrival = arrival;
+		}
+
+		reason = (parse_hex(hex, encoded) != 0 || decode_frame(encoded, frame) != 0) ?
+				REJECT_HAMMING : handle_frame(&gantry, arrival, frame);
+
+		if (reason >= 0) {
+			rejected[reason]++;
+			totalRejected++;
+			if (verbose) {
+				printf("%10.1f rejected (%s)\n", arrival, rejectNames[reason]);
+			}
+		}
+	}
+
+	// REPORT
+	printf("frames           %d (%d bits corrected)\n", frames, corrected);
+	printf("rejected         %d", totalRejected);
+	for (int i = 0; i < REJECT_COUNT; i++) {
+		printf("  %s %d", rejectNames[i], rejected[i]);
+	}
+	printf("\ncommands         %d\n", commands);
+
+	if (commands > 0 && lastDone > firstArrival) {
+		printf("commands/s       %.2f\n", commands * 1000.0 / (lastDone - firstArrival));
+	}
+
+	print_percentiles("latency", latency, (commands < MAX_COMMANDS) ? commands : MAX_COMMANDS);
+	print_percentiles("exec lateness", lateness, scheduled);
+
+	return 0;
+}
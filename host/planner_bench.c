@@ -0,0 +1,200 @@
+ /**
+ **************************************************************
+ * @file host/planner_bench.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Host (Linux) benchmark for the pick and place planner.
+ * Generates seeded random job sets over the ASC XY grid, times
+ * s4741858_lib_planner_order() on each and reports the planned
+ * travel against the naive (submitted) order.
+ ***************************************************************
+ * BUILD (from this directory)
+ ***************************************************************
+ * gcc -O2 -I.. -o planner_bench planner_bench.c ../s4741858_planner.c
+ ***************************************************************
+ * usage: planner_bench [-v] [-n jobs] [-c sets] [-r repeats]
+ *                      [-s seed]
+ * -n jobs per set, 1 - PLANNER_MAX_JOBS (default all)
+ * -c job sets generated (default 1000)
+ * -r planner calls timed per set, the fastest is kept (default 5)
+ * -s seed, the same seed gives the same job sets on any host
+ ***************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "s4741858_planner.h"
+
+#define GRID_MAX 150 // ASC_XY_MAX, both axes
+
+/* Job Generation ---------------------------------------------------------*/
+static uint32_t rngState;
+
+/*
+ * xorshift32 - not rand(), so a seed means the same sets everywhere
+ */
+static uint32_t bench_rand(void) {
+
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static uint8_t bench_coord(void) {
+
+	return bench_rand() % (GRID_MAX + 1);
+}
+
+static void bench_jobs(ASC_PlannerJobList *jobList, int count) {
+
+	jobList->target = 0;
+	jobList->count = count;
+
+	for (int i = 0; i < count; i++) {
+		jobList->jobs[i].pickX = bench_coord();
+		jobList->jobs[i].pickY = bench_coord();
+		jobList->jobs[i].placeX = bench_coord();
+		jobList->jobs[i].placeY = bench_coord();
+	}
+}
+
+/* Checks ---------------------------------------------------------*/
+/*
+ * Every job exactly once
+ */
+static int bench_permutation(const uint8_t order[PLANNER_MAX_JOBS], int count) {
+
+	uint32_t seen = 0;
+
+	for (int n = 0; n < count; n++) {
+		if ((order[n] >= count) || (seen & (1u << order[n]))) {
+			return 0;
+		}
+		seen |= 1u << order[n];
+	}
+	return 1;
+}
+
+static double bench_micros(const struct timespec *a, const struct timespec *b) {
+
+	return (b->tv_sec - a->tv_sec) * 1e6 + (b->tv_nsec - a->tv_nsec) / 1e3;
+}
+
+static int bench_compare(const void *a, const void *b) {
+
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv) {
+
+	int jobs = PLANNER_MAX_JOBS;
+	int sets = 1000;
+	int repeats = 5;
+	int verbose = 0;
+	uint32_t seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vn:c:r:s:")) != -1) {
+		switch (opt) {
+			case 'v': verbose = 1; break;
+			case 'n': jobs = atoi(optarg); break;
+			case 'c': sets = atoi(optarg); break;
+			case 'r': repeats = atoi(optarg); break;
+			case 's': seed = strtoul(optarg, NULL, 0); break;
+			default:
+				fprintf(stderr, "usage: %s [-v] [-n jobs] [-c sets] [-r repeats] [-s seed]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	if ((jobs < 1) || (jobs > PLANNER_MAX_JOBS) || (sets < 1) || (repeats < 1)) {
+		fprintf(stderr, "jobs 1 - %d, sets and repeats at least 1\n", PLANNER_MAX_JOBS);
+		return 1;
+	}
+
+	rngState = (seed != 0) ? seed : 1; // xorshift sticks at zero
+
+	double *micros = malloc(sets * sizeof(double));
+	uint64_t naiveTotal = 0;
+	uint64_t plannedTotal = 0;
+	double bestSaving = 0;
+	double worstSaving = 100;
+	int worse = 0;
+
+	if (micros == NULL) {
+		perror("malloc");
+		return 1;
+	}
+
+	for (int set = 0; set < sets; set++) {
+		ASC_PlannerJobList jobList;
+		uint8_t naive[PLANNER_MAX_JOBS];
+		uint8_t order[PLANNER_MAX_JOBS];
+		uint8_t startX = bench_coord();
+		uint8_t startY = bench_coord();
+		uint32_t planned = 0;
+
+		bench_jobs(&jobList, jobs);
+		for (int n = 0; n < jobs; n++) {
+			naive[n] = n;
+		}
+
+		// TIMING - fastest of the repeats, the least disturbed by the host
+		micros[set] = 0;
+		for (int r = 0; r < repeats; r++) {
+			struct timespec start, end;
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			planned = s4741858_lib_planner_order(&jobList, startX, startY, order);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			if ((r == 0) || (bench_micros(&start, &end) < micros[set])) {
+				micros[set] = bench_micros(&start, &end);
+			}
+		}
+
+		if (!bench_permutation(order, jobs) ||
+				(planned != s4741858_lib_planner_cost(&jobList, startX, startY, order))) {
+			fprintf(stderr, "set %d: planner returned a bad order\n", set);
+			free(micros);
+			return 2;
+		}
+
+		uint32_t travel = s4741858_lib_planner_cost(&jobList, startX, startY, naive);
+		double saving = (travel != 0) ? 100.0 * ((double) travel - planned) / travel : 0;
+
+		naiveTotal += travel;
+		plannedTotal += planned;
+		bestSaving = (saving > bestSaving) ? saving : bestSaving;
+		worstSaving = (saving < worstSaving) ? saving : worstSaving;
+		worse += (planned > travel);
+
+		if (verbose) {
+			printf("set %5d  naive %6u  planned %6u  saving %5.1f %%  %8.2f us\n",
+				set, travel, planned, saving, micros[set]);
+		}
+	}
+
+	qsort(micros, sets, sizeof(double), bench_compare);
+
+	printf("job sets         %d of %d jobs, seed %u\n", sets, jobs, seed);
+	printf("travel naive     %llu\n", (unsigned long long) naiveTotal);
+	printf("travel planned   %llu (%.1f %% saved, best %.1f %%, worst %.1f %%)\n",
+		(unsigned long long) plannedTotal,
+		(naiveTotal != 0) ? 100.0 * ((double) naiveTotal - plannedTotal) / naiveTotal : 0.0,
+		bestSaving, worstSaving);
+	printf("planned longer   %d sets\n", worse);
+	printf("planner time     p50 %8.2f  p99 %8.2f  max %8.2f us (host)\n",
+		micros[sets / 2], micros[(sets * 99) / 100], micros[sets - 1]);
+
+	free(micros);
+	return 0;
+}
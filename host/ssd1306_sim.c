@@ -0,0 +1,670 @@
+ /**
+ **************************************************************
+ * @file host/ssd1306_sim.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Host (Linux) stand-in for the SSD1306 library calls and
+ * the I2C bus behind s4741858_reg_oled_init(). Every transfer is
+ * run through a model of the controller - GDDRAM, addressing
+ * modes, column / page windows and the display start line - so
+ * the exported frame is what the panel would show, and every
+ * byte on the bus is counted per update.
+ ***************************************************************
+ * BUILD (from this directory)
+ ***************************************************************
+ * gcc -O2 -o ssd1306_sim ssd1306_sim.c
+ *
+ * As a library in a host build of display code - the ssd1306_*
+ * calls link against this file instead of the board library:
+ * gcc -DSSD1306_SIM_NO_MAIN ... ssd1306_sim.c <board>/fonts.c
+ ***************************************************************
+ * INPUT - one I2C write per line, as traced by s4741858_oled.c
+ * with OLED_BUS_TRACE, '#' lines ignored
+ ***************************************************************
+ * C <hex bytes>   command stream (control byte 0x00)
+ * D <hex bytes>   GDDRAM data stream (control byte 0x40)
+ * F               end of one update (one flush)
+ *
+ * usage: ssd1306_sim [-v] [-k bus kHz] [-o prefix] [-p]
+ *                    [-g golden.pbm] [file]
+ * -o writes <prefix>NNNN.pbm per update (.png as well with -p)
+ * -g compares the last update with a golden image, exit 3 if
+ * any pixel differs
+ *
+ * traces/ holds recorded cases with their golden images, e.g.
+ * ssd1306_sim -g traces/oled_log_scroll.pbm traces/oled_log_scroll.txt
+ ***************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ssd1306_sim.h"
+
+#define MAX_TRANSFER 2048 // longest stream on one trace line
+
+/* Controller Model ---------------------------------------------------------*/
+#define MODE_HORIZONTAL 0
+#define MODE_VERTICAL   1
+#define MODE_PAGE       2
+
+typedef struct {
+	uint8_t ram[SSD1306_RAM_PAGES][SSD1306_WIDTH];
+	uint8_t mode;
+	uint8_t column;     // write pointer
+	uint8_t page;
+	uint8_t columnStart; // window, horizontal / vertical modes
+	uint8_t columnEnd;
+	uint8_t pageStart;
+	uint8_t pageEnd;
+	uint8_t startLine;  // GDDRAM row shown at the top
+	uint8_t displayOn;
+	uint8_t inverted;
+	uint8_t entireOn;
+	uint8_t pending[7]; // command and parameters being collected
+	uint8_t pendingCount;
+	uint8_t pendingNeed;
+} Controller;
+
+static Controller ssd;
+static uint32_t busHz = 400000;
+static SSD1306_SimCounters frameCount;
+static SSD1306_SimCounters totalCount;
+
+/* Library State ---------------------------------------------------------*/
+uint8_t SSD1306_Buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+static uint8_t cursorX;
+static uint8_t cursorY;
+
+/*
+ * Parameter bytes that follow a command byte.
+ */
+static int command_params(uint8_t cmd) {
+
+	switch (cmd) {
+		case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+		case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+			return 1;
+		case 0x21: case 0x22: case 0xA3:
+			return 2;
+		case 0x29: case 0x2A:
+			return 5;
+		case 0x26: case 0x27:
+			return 6;
+		default:
+			return 0;
+	}
+}
+
+/*
+ * Applies one complete command. Scroll setup is accepted and ignored -
+ * continuous scrolling moves the picture but never GDDRAM.
+ */
+static void command_apply(const uint8_t *cmd) {
+
+	uint8_t op = cmd[0];
+
+	if (op <= 0x0F) {
+		ssd.column = (ssd.column & 0xF0) | op;         // page mode, low nibble
+	} else if (op <= 0x1F) {
+		ssd.column = (ssd.column & 0x0F) | ((op & 0x07) << 4);
+	} else if ((op >= 0x40) && (op <= 0x7F)) {
+		ssd.startLine = op & 0x3F;
+	} else if ((op >= 0xB0) && (op <= 0xB7)) {
+		ssd.page = op & 0x07;
+	}
+
+	switch (op) {
+		case 0x20:
+			ssd.mode = cmd[1] & 0x03;
+			break;
+		case 0x21:
+			ssd.columnStart = cmd[1] & 0x7F;
+			ssd.columnEnd = cmd[2] & 0x7F;
+			ssd.column = ssd.columnStart;
+			break;
+		case 0x22:
+			ssd.pageStart = cmd[1] & 0x07;
+			ssd.pageEnd = cmd[2] & 0x07;
+			ssd.page = ssd.pageStart;
+			break;
+		case 0xA4: ssd.entireOn = 0; break;
+		case 0xA5: ssd.entireOn = 1; break;
+		case 0xA6: ssd.inverted = 0; break;
+		case 0xA7: ssd.inverted = 1; break;
+		case 0xAE: ssd.displayOn = 0; break;
+		case 0xAF: ssd.displayOn = 1; break;
+	}
+}
+
+/*
+ * Writes one GDDRAM byte and advances the pointer the way the selected
+ * addressing mode does.
+ */
+static void data_write(uint8_t byte) {
+
+	ssd.ram[ssd.page][ssd.column] = byte;
+
+	switch (ssd.mode) {
+		case MODE_HORIZONTAL:
+			if (ssd.column++ >= ssd.columnEnd) {
+				ssd.column = ssd.columnStart;
+				ssd.page = (ssd.page >= ssd.pageEnd) ? ssd.pageStart : ssd.page + 1;
+			}
+			break;
+		case MODE_VERTICAL:
+			if (ssd.page++ >= ssd.pageEnd) {
+				ssd.page = ssd.pageStart;
+				ssd.column = (ssd.column >= ssd.columnEnd) ? ssd.columnStart : ssd.column + 1;
+			}
+			break;
+		default:
+			ssd.column = (ssd.column + 1) & 0x7F;
+			break;
+	}
+}
+
+/*
+ * Adds one transfer to the frame and run counters.
+ */
+static void count_transfer(uint8_t control, size_t length) {
+
+	uint32_t wire = 2 + length; // address + control byte
+
+	frameCount.transactions++;
+	frameCount.wireBytes += wire;
+	// 9 clocks a byte (ACK), about 2 more for START and STOP
+	frameCount.busMicros += (uint32_t) (((uint64_t) (wire * 9 + 2) * 1000000) / busHz);
+	if (control == SSD1306_CONTROL_DATA) {
+		frameCount.dataBytes += length;
+	} else {
+		frameCount.commandBytes += length;
+	}
+}
+
+/* SIMULATOR FUNCTIONS ---------------------------------------------------------*/
+
+/**
+ * @brief Controller to its power on state - page addressing, full
+ * window, start line 0, display off. Counters cleared.
+ * @param hz simulated SCL clock, bus time is worked out from it
+ */
+void ssd1306_sim_reset(uint32_t hz) {
+
+	memset(&ssd, 0, sizeof(ssd));
+	ssd.mode = MODE_PAGE;
+	ssd.columnEnd = SSD1306_WIDTH - 1;
+	ssd.pageEnd = SSD1306_RAM_PAGES - 1;
+
+	busHz = (hz != 0) ? hz : busHz;
+	ssd1306_sim_clear();
+}
+
+/**
+ * @brief Zeroes the update and run counters, controller untouched.
+ */
+void ssd1306_sim_clear(void) {
+
+	memset(&frameCount, 0, sizeof(frameCount));
+	memset(&totalCount, 0, sizeof(totalCount));
+}
+
+/**
+ * @brief One I2C write to the display - the control byte selects a
+ * command stream or GDDRAM data, as sent by s4741858_oled.c.
+ */
+void ssd1306_sim_transfer(uint8_t control, const uint8_t *data, size_t length) {
+
+	count_transfer(control, length);
+
+	for (size_t i = 0; i < length; i++) {
+		if (control == SSD1306_CONTROL_DATA) {
+			data_write(data[i]);
+			continue;
+		}
+
+		// COMMAND STREAM - parameters may follow in the same transfer or the next
+		if (ssd.pendingNeed == 0) {
+			ssd.pending[0] = data[i];
+			ssd.pendingCount = 1;
+			ssd.pendingNeed = 1 + command_params(data[i]);
+		} else {
+			ssd.pending[ssd.pendingCount++] = data[i];
+		}
+
+		if (ssd.pendingCount == ssd.pendingNeed) {
+			command_apply(ssd.pending);
+			ssd.pendingNeed = 0;
+		}
+	}
+}
+
+/**
+ * @brief Ends one update - the counters since the last call are
+ * returned and added to the run totals.
+ */
+SSD1306_SimCounters ssd1306_sim_frame(void) {
+
+	SSD1306_SimCounters frame = frameCount;
+
+	totalCount.transactions += frame.transactions;
+	totalCount.commandBytes += frame.commandBytes;
+	totalCount.dataBytes += frame.dataBytes;
+	totalCount.wireBytes += frame.wireBytes;
+	totalCount.busMicros += frame.busMicros;
+	memset(&frameCount, 0, sizeof(frameCount));
+
+	return frame;
+}
+
+/**
+ * @brief Run totals of every completed update.
+ */
+SSD1306_SimCounters ssd1306_sim_total(void) {
+	return totalCount;
+}
+
+/**
+ * @brief Pixel as seen on the panel - start line, invert, entire on
+ * and display off applied.
+ * @return 1 lit, 0 dark
+ */
+int ssd1306_sim_pixel(int x, int y) {
+
+	int row = (ssd.startLine + y) % (SSD1306_RAM_PAGES * 8);
+	int lit = (ssd.ram[row >> 3][x] >> (row & 7)) & 0x01;
+
+	if (!ssd.displayOn) {
+		return 0;
+	}
+	lit = ssd.entireOn ? 1 : lit;
+
+	return lit ^ ssd.inverted;
+}
+
+/**
+ * @brief Writes the panel image as a binary PBM (P4), 1 = lit.
+ * @return 0 ok, -1 file error
+ */
+int ssd1306_sim_write_pbm(const char *path) {
+
+	FILE *out = fopen(path, "wb");
+
+	if (out == NULL) {
+		return -1;
+	}
+
+	fprintf(out, "P4\n%d %d\n", SSD1306_WIDTH, SSD1306_HEIGHT);
+	for (int y = 0; y < SSD1306_HEIGHT; y++) {
+		for (int x = 0; x < SSD1306_WIDTH; x += 8) {
+			uint8_t bits = 0;
+
+			for (int b = 0; b < 8; b++) {
+				bits |= ssd1306_sim_pixel(x + b, y) << (7 - b);
+			}
+			fputc(bits, out);
+		}
+	}
+
+	return fclose(out);
+}
+
+/*
+ * PNG chunk CRC.
+ */
+static uint32_t png_crc(uint32_t crc, const uint8_t *data, size_t length) {
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++) {
+		crc ^= data[i];
+		for (int b = 0; b < 8; b++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+
+	return ~crc;
+}
+
+static void png_be32(uint8_t *out, uint32_t value) {
+
+	out[0] = value >> 24;
+	out[1] = value >> 16;
+	out[2] = value >> 8;
+	out[3] = value;
+}
+
+static void png_chunk(FILE *out, const char *type, const uint8_t *data, uint32_t length) {
+
+	uint8_t word[4];
+	uint32_t crc;
+
+	png_be32(word, length);
+	fwrite(word, 1, 4, out);
+	fwrite(type, 1, 4, out);
+	fwrite(data, 1, length, out);
+
+	crc = png_crc(0, (const uint8_t *) type, 4);
+	crc = png_crc(crc, data, length);
+	png_be32(word, crc);
+	fwrite(word, 1, 4, out);
+}
+
+/**
+ * @brief Writes the panel image as an 8 bit greyscale PNG, lit pixels
+ * white. The deflate stream uses stored blocks, so no zlib is needed.
+ * @return 0 ok, -1 file error
+ */
+int ssd1306_sim_write_png(const char *path) {
+
+	static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	enum { ROW = 1 + SSD1306_WIDTH, RAW = ROW * SSD1306_HEIGHT };
+	static uint8_t raw[RAW];
+	static uint8_t zdata[2 + 5 + RAW + 4];
+	uint8_t header[13];
+	uint32_t a = 1;
+	uint32_t b = 0;
+	FILE *out;
+
+	// SCANLINES - filter byte 0, one byte a pixel
+	for (int y = 0; y < SSD1306_HEIGHT; y++) {
+		raw[y * ROW] = 0;
+		for (int x = 0; x < SSD1306_WIDTH; x++) {
+			raw[y * ROW + 1 + x] = ssd1306_sim_pixel(x, y) ? 0xFF : 0x00;
+		}
+	}
+
+	// ZLIB - header, one final stored block, adler32
+	zdata[0] = 0x78;
+	zdata[1] = 0x01;
+	zdata[2] = 0x01;
+	zdata[3] = RAW & 0xFF;
+	zdata[4] = RAW >> 8;
+	zdata[5] = ~RAW & 0xFF;
+	zdata[6] = (~RAW >> 8) & 0xFF;
+	memcpy(&zdata[7], raw, RAW);
+	for (int i = 0; i < RAW; i++) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	png_be32(&zdata[7 + RAW], (b << 16) | a);
+
+	png_be32(&header[0], SSD1306_WIDTH);
+	png_be32(&header[4], SSD1306_HEIGHT);
+	header[8] = 8;   // bit depth
+	header[9] = 0;   // greyscale
+	header[10] = 0;  // deflate
+	header[11] = 0;  // adaptive filtering
+	header[12] = 0;  // no interlace
+
+	if ((out = fopen(path, "wb")) == NULL) {
+		return -1;
+	}
+	fwrite(signature, 1, sizeof(signature), out);
+	png_chunk(out, "IHDR", header, sizeof(header));
+	png_chunk(out, "IDAT", zdata, sizeof(zdata));
+	png_chunk(out, "IEND", NULL, 0);
+
+	return fclose(out);
+}
+
+/**
+ * @brief Compares the panel image with a golden P4 PBM.
+ * @return pixels that differ, -1 if the file is missing or not a
+ * 128x32 P4 image
+ */
+int ssd1306_sim_compare(const char *path) {
+
+	FILE *in = fopen(path, "rb");
+	int width, height;
+	int differ = 0;
+
+	if (in == NULL) {
+		return -1;
+	}
+
+	if ((fscanf(in, "P4 %d %d", &width, &height) != 2) || (width != SSD1306_WIDTH) ||
+			(height != SSD1306_HEIGHT) || (fgetc(in) == EOF)) {
+		fclose(in);
+		return -1;
+	}
+
+	for (int y = 0; y < SSD1306_HEIGHT; y++) {
+		for (int x = 0; x < SSD1306_WIDTH; x += 8) {
+			int bits = fgetc(in);
+
+			if (bits == EOF) {
+				fclose(in);
+				return -1;
+			}
+			for (int n = 0; n < 8; n++) {
+				differ += ((bits >> (7 - n)) & 0x01) != ssd1306_sim_pixel(x + n, y);
+			}
+		}
+	}
+
+	fclose(in);
+	return differ;
+}
+
+/* LIBRARY CALLS ---------------------------------------------------------*/
+
+/**
+ * @brief One command byte per transfer, as the board library sends.
+ */
+void ssd1306_WriteCommand(uint8_t byte) {
+	ssd1306_sim_transfer(SSD1306_CONTROL_CMD, &byte, 1);
+}
+
+void ssd1306_WriteData(uint8_t *buffer, size_t size) {
+	ssd1306_sim_transfer(SSD1306_CONTROL_DATA, buffer, size);
+}
+
+/**
+ * @brief Library init sequence for the 128x32 panel, then a blank
+ * screen sent the library way.
+ */
+void ssd1306_Init(void) {
+
+	static const uint8_t init[] = {
+		0xAE,       // display off
+		0x20, 0x00, // horizontal addressing
+		0xB0,       // page 0
+		0xC8,       // COM scan remapped
+		0x00, 0x10, // column 0
+		0x40,       // start line 0
+		0x81, 0xFF, // contrast
+		0xA1,       // segment remap
+		0xA6,       // normal
+		0xA8, 0x1F, // 32 MUX
+		0xA4,       // follow RAM
+		0xD3, 0x00, // no offset
+		0xD5, 0xF0, // clock
+		0xD9, 0x22, // precharge
+		0xDA, 0x02, // COM pins for 32 rows
+		0xDB, 0x20, // VCOMH
+		0x8D, 0x14, // charge pump
+		0xAF,       // display on
+	};
+
+	for (size_t i = 0; i < sizeof(init); i++) {
+		ssd1306_WriteCommand(init[i]);
+	}
+
+	ssd1306_Fill(Black);
+	ssd1306_UpdateScreen();
+	cursorX = 0;
+	cursorY = 0;
+}
+
+void ssd1306_Fill(SSD1306_COLOR color) {
+	memset(SSD1306_Buffer, (color == Black) ? 0x00 : 0xFF, sizeof(SSD1306_Buffer));
+}
+
+void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color) {
+
+	if ((x >= SSD1306_WIDTH) || (y >= SSD1306_HEIGHT)) {
+		return;
+	}
+
+	if (color == White) {
+		SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
+	} else {
+		SSD1306_Buffer[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
+	}
+}
+
+/**
+ * @brief Whole buffer, page by page - the traffic the driver paid
+ * before partial updates.
+ */
+void ssd1306_UpdateScreen(void) {
+
+	for (int page = 0; page < SSD1306_HEIGHT / 8; page++) {
+		ssd1306_WriteCommand(0xB0 + page);
+		ssd1306_WriteCommand(0x00);
+		ssd1306_WriteCommand(0x10);
+		ssd1306_WriteData(&SSD1306_Buffer[SSD1306_WIDTH * page], SSD1306_WIDTH);
+	}
+}
+
+void ssd1306_SetCursor(uint8_t x, uint8_t y) {
+
+	cursorX = x;
+	cursorY = y;
+}
+
+char ssd1306_WriteChar(char ch, FontDef font, SSD1306_COLOR color) {
+
+	if ((ch < 32) || (ch > 126) || (cursorX + font.FontWidth > SSD1306_WIDTH) ||
+			(cursorY + font.FontHeight > SSD1306_HEIGHT)) {
+		return 0;
+	}
+
+	for (int row = 0; row < font.FontHeight; row++) {
+		uint16_t bits = font.data[(ch - 32) * font.FontHeight + row];
+
+		for (int col = 0; col < font.FontWidth; col++) {
+			ssd1306_DrawPixel(cursorX + col, cursorY + row,
+					((bits << col) & 0x8000) ? color : !color);
+		}
+	}
+	cursorX += font.FontWidth;
+
+	return ch;
+}
+
+char ssd1306_WriteString(char *str, FontDef font, SSD1306_COLOR color) {
+
+	for (; *str != '\0'; str++) {
+		if (ssd1306_WriteChar(*str, font, color) != *str) {
+			return *str;
+		}
+	}
+
+	return *str;
+}
+
+/* TRACE REPLAY ---------------------------------------------------------*/
+#ifndef SSD1306_SIM_NO_MAIN
+
+int main(int argc, char **argv) {
+
+	FILE *in = stdin;
+	char line[4 * MAX_TRANSFER];
+	static uint8_t bytes[MAX_TRANSFER];
+	const char *prefix = NULL;
+	const char *golden = NULL;
+	int png = 0;
+	int verbose = 0;
+	int updates = 0;
+	uint32_t maxWire = 0;
+	SSD1306_SimCounters total;
+	int opt;
+
+	ssd1306_sim_reset(400000);
+
+	while ((opt = getopt(argc, argv, "vk:o:pg:")) != -1) {
+		switch (opt) {
+			case 'v': verbose = 1; break;
+			case 'k': ssd1306_sim_reset(atoi(optarg) * 1000); break;
+			case 'o': prefix = optarg; break;
+			case 'p': png = 1; break;
+			case 'g': golden = optarg; break;
+			default:
+				fprintf(stderr, "usage: %s [-v] [-k bus kHz] [-o prefix] [-p] [-g golden.pbm] [file]\n", argv[0]);
+				return 2;
+		}
+	}
+
+	if (optind < argc && (in = fopen(argv[optind], "r")) == NULL) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	// Panel already initialised - traces start at the first flush
+	ssd1306_Init();
+	ssd1306_sim_clear();
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		char *p = line + 1;
+		size_t length = 0;
+		int used;
+		unsigned int byte;
+
+		if ((line[0] == 'C') || (line[0] == 'D')) {
+			while ((length < MAX_TRANSFER) && (sscanf(p, "%2x%n", &byte, &used) == 1)) {
+				bytes[length++] = byte;
+				p += used;
+			}
+			ssd1306_sim_transfer((line[0] == 'C') ? SSD1306_CONTROL_CMD : SSD1306_CONTROL_DATA, bytes, length);
+
+		} else if (line[0] == 'F') {
+			SSD1306_SimCounters frame = ssd1306_sim_frame();
+			char path[512];
+
+			maxWire = (frame.wireBytes > maxWire) ? frame.wireBytes : maxWire;
+			if (verbose) {
+				printf("update %4d  %3u transfers  %4u cmd  %5u data  %5u wire bytes  %6u us\n", updates,
+						frame.transactions, frame.commandBytes, frame.dataBytes, frame.wireBytes, frame.busMicros);
+			}
+
+			if (prefix != NULL) {
+				snprintf(path, sizeof(path), "%s%04d.pbm", prefix, updates);
+				ssd1306_sim_write_pbm(path);
+				if (png) {
+					snprintf(path, sizeof(path), "%s%04d.png", prefix, updates);
+					ssd1306_sim_write_png(path);
+				}
+			}
+			updates++;
+		}
+	}
+
+	total = ssd1306_sim_total();
+	printf("updates        %d\n", updates);
+	printf("transfers      %u (%.1f per update)\n", total.transactions, updates ? (double) total.transactions / updates : 0.0);
+	printf("command bytes  %u\n", total.commandBytes);
+	printf("data bytes     %u\n", total.dataBytes);
+	printf("wire bytes     %u (%.1f per update, max %u)\n", total.wireBytes,
+			updates ? (double) total.wireBytes / updates : 0.0, maxWire);
+	printf("bus time       %.1f ms (%.2f ms per update)\n", total.busMicros / 1000.0,
+			updates ? total.busMicros / 1000.0 / updates : 0.0);
+
+	if (golden != NULL) {
+		int differ = ssd1306_sim_compare(golden);
+
+		if (differ < 0) {
+			fprintf(stderr, "%s: not a %dx%d P4 image\n", golden, SSD1306_WIDTH, SSD1306_HEIGHT);
+			return 1;
+		}
+		printf("golden         %d pixels differ\n", differ);
+		return (differ != 0) ? 3 : 0;
+	}
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,97 @@
+ /**
+ **************************************************************
+ * @file host/ssd1306_sim.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Host (Linux) stand-in for the SSD1306 library calls and
+ * the I2C bus behind s4741858_reg_oled_init(). Models the
+ * controller's GDDRAM and addressing, counts bus traffic and
+ * exports what the panel would show as PBM / PNG.
+ ***************************************************************
+ * LIBRARY CALLS (same names as the board ssd1306 library)
+ ***************************************************************
+ * ssd1306_Init() ssd1306_Fill() ssd1306_DrawPixel()
+ * ssd1306_UpdateScreen() ssd1306_WriteCommand() ssd1306_WriteData()
+ * ssd1306_SetCursor() ssd1306_WriteChar() ssd1306_WriteString()
+ ***************************************************************
+ * SIMULATOR FUNCTIONS
+ ***************************************************************
+ * ssd1306_sim_reset() - controller back to power on state
+ * ssd1306_sim_clear() - zeroes the counters
+ * ssd1306_sim_transfer() - one I2C write, control byte + stream
+ * ssd1306_sim_frame() - ends an update, returns its counters
+ * ssd1306_sim_pixel() - visible pixel, start line applied
+ * ssd1306_sim_write_pbm() / ssd1306_sim_write_png() - export
+ * ssd1306_sim_compare() - pixels differing from a golden PBM
+ ***************************************************************
+ */
+
+#ifndef SSD1306_SIM_H
+#define SSD1306_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Panel ---------------------------------------------------------*/
+#define SSD1306_WIDTH      128
+#define SSD1306_HEIGHT     32
+#define SSD1306_RAM_PAGES  8   // GDDRAM is 128x64 whatever the panel height
+
+#define SSD1306_I2C_ADDR   0x78 // write address, 0x3C
+#define SSD1306_CONTROL_CMD  0x00
+#define SSD1306_CONTROL_DATA 0x40
+
+typedef enum {
+	Black = 0,
+	White = 1
+} SSD1306_COLOR;
+
+#define SSD1306_BLACK Black
+#define SSD1306_WHITE White
+
+// Font layout of the board library fonts.h - row bitmaps, MSB is the left
+// pixel. This header stands in for oled_pixel.h / oled_string.h / fonts.h
+typedef struct {
+	uint8_t FontWidth;
+	uint8_t FontHeight;
+	const uint16_t *data;
+} FontDef;
+
+extern FontDef Font_6x8; // link the board library fonts.c for text
+
+// Library frame buffer - pages of columns, LSB at the top
+extern uint8_t SSD1306_Buffer[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+
+/* Bus Accounting ---------------------------------------------------------*/
+// One I2C write = START, address, control byte, payload, STOP
+typedef struct {
+	uint32_t transactions;
+	uint32_t commandBytes; // payload of command transfers
+	uint32_t dataBytes;    // payload of GDDRAM transfers
+	uint32_t wireBytes;    // everything clocked, address and control included
+	uint32_t busMicros;    // at the simulated clock, 9 bits a byte
+} SSD1306_SimCounters;
+
+/* Library Calls ---------------------------------------------------------*/
+void ssd1306_Init(void);
+void ssd1306_Fill(SSD1306_COLOR color);
+void ssd1306_DrawPixel(uint8_t x, uint8_t y, SSD1306_COLOR color);
+void ssd1306_UpdateScreen(void);
+void ssd1306_WriteCommand(uint8_t byte);
+void ssd1306_WriteData(uint8_t *buffer, size_t size);
+void ssd1306_SetCursor(uint8_t x, uint8_t y);
+char ssd1306_WriteChar(char ch, FontDef font, SSD1306_COLOR color);
+char ssd1306_WriteString(char *str, FontDef font, SSD1306_COLOR color);
+
+/* Simulator ---------------------------------------------------------*/
+void ssd1306_sim_reset(uint32_t busHz);
+void ssd1306_sim_clear(void);
+void ssd1306_sim_transfer(uint8_t control, const uint8_t *data, size_t length);
+SSD1306_SimCounters ssd1306_sim_frame(void);
+SSD1306_SimCounters ssd1306_sim_total(void);
+int ssd1306_sim_pixel(int x, int y);
+int ssd1306_sim_write_pbm(const char *path);
+int ssd1306_sim_write_png(const char *path);
+int ssd1306_sim_compare(const char *path);
+
+#endif
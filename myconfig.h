@@ -8,16 +8,36 @@
  *
  ***************************************************************
  **/
+#ifndef MYCONFIG_H
+#define MYCONFIG_H
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #define MYRADIOCHAN 58
+#define MYRADIOADDR 0x30, 0x10, 0x00, 0x00, 0x58
+
+// rig 0 address, defined once in s4741858_txradio.c - the nrf24l01plus
+// library loads it in nrf24l01plus_init()
+extern uint8_t myradiotxaddr[5];
 
+/*
+ * Gantry rigs driven by this controller - one row per rig, row 0 is
+ * the default target and is MYRADIOCHAN / MYRADIOADDR. X(channel,
+ * (tx address bytes), weight), weight is packets sent to the rig per
+ * scheduler round when others are busy.
+ */
+#define MYRADIO_TARGET_TABLE(X) \
+  X(MYRADIOCHAN, (MYRADIOADDR), 1) /* RIG 0 */
 
-uint8_t myradiotxaddr[5] = {0x30, 0x10, 0x00, 0x00, 0x58};
+// second rig example - append to the table above
+//  X(59, (0x30, 0x10, 0x00, 0x00, 0x59), 1) /* RIG 1 */
 
 
 //XENON TEST MONITOR ADDRESS
 
 // #define MYRADIOCHAN 40
-// uint8_t myradiotxaddr[5] = {0x12, 0x34, 0x56, 0x78, 0x90};
+// #define MYRADIOADDR 0x12, 0x34, 0x56, 0x78, 0x90
+
+#endif
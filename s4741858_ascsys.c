@@ -13,18 +13,102 @@
  ***************************************************************
    * EXTERNAL FUNCTIONS 
  ***************************************************************
- 
+ * s4741858_ascsys_submit_jobs() - hands a pick and place job
+ * list to the controller for planning and batch transmit
+ * s4741858_ascsys_macro_record() - start / stop macro recording
+ * s4741858_ascsys_macro_replay() - replay the recorded macro
+ * s4741858_ascsys_schedule() - send commands ahead with execute-at
+ * ticks once the gantry clock is synced
+ * s4741858_ascsys_jog() - enable / disable joystick jog streaming
+ * s4741858_ascsys_trajectory() - enable / disable interpolated
+ * XYZ moves
+ * s4741858_ascsys_select_target() - rig driven by keypad / jog
+ * s4741858_ascsys_target_state() - last state sent to a rig
  *************************************************************** 
  **/
 
 #include "s4741858_ascsys.h"
+#include <string.h>
+#include <stdlib.h>
 
 /* Global RTOS Structures Decleration */
 extern QueueHandle_t s4741858QueueOLEDMessage; // OLED TASK
 extern EventGroupHandle_t keypadctrlEventGroup; // KEYPAD TASK
 extern QueueHandle_t s4741858QueueRadioTXMessage;// RADIO QUEUE
+QueueHandle_t s4741858QueuePlannerJobs; // PLANNER JOB LISTS
 
-static uint16_t currentKeypadValue; // keypad value for FSM controller
+static const ASC_KeyAction *currentKeyAction; // resolved key action for FSM controller
+static EventBits_t pendingKeyBits; // keys still to be processed in this batch
+static uint32_t keyPressTick;      // key edge, rides on the first packet it causes - 0 once sent
+
+// MACRO RING BUFFER - mirrored to flash when recording stops
+static ASC_MacroCommand macroBuffer[MACRO_MAX_COMMANDS];
+static uint16_t macroHead;        // next write slot
+static uint16_t macroCount;       // valid commands in ring
+static uint16_t macroReplayIndex; // commands replayed so far
+static uint8_t macroRecording;
+static uint8_t macroReplayMode = MACRO_REPLAY_OFF;
+static volatile uint8_t macroRequest = MACRO_REQUEST_NONE; // posted by other tasks
+static uint32_t macroLastTick;    // tick of last recorded command
+
+// GANTRY MOTION MODEL - gates command release, drives OLED progress
+static ASC_MotionModel motionModels[RADIO_MAX_TARGETS];
+static ASC_MotionModel *motion = &motionModels[0]; // active rig
+static OLED_ASCMessage SendValues; // last display state sent
+
+// SCHEDULED COMMANDS - gantry executes at predicted start tick
+static uint8_t scheduleEnabled = ASC_SCHEDULE_DEFAULT;
+static uint8_t execMessage[4] = {'E', 'X', 'E', 'C'};
+
+// JOYSTICK JOG - entered from idle on stick deflection
+static uint8_t jogEnabled = 1;
+static uint8_t jogActive = 0; // streaming - no gating, no EXEC
+
+// TRAJECTORY - XYZ moves streamed as blended waypoints
+static ASC_Trajectory traj;
+static uint8_t trajEnabled = ASC_TRAJ_DEFAULT;
+static TickType_t trajWakeTick;
+
+// MULTIPLE RIGS - per target state, keypad drives the active one
+static ASC_GantryState gantries[RADIO_MAX_TARGETS];
+static uint8_t activeTarget = 0;
+static volatile uint8_t requestedTarget = 0;
+static uint8_t planInterleaved = 0; // several rigs planning, no waypoints
+
+// WORKSPACE - soft limits and keep-out zones, every target checked
+static ASC_Workspace workspace;
+
+// RADIO QUEUE MESSAGE DECLARATIONS
+static uint8_t senderAdress[4] = {0x47, 0x41, 0x85, 0x89};
+static uint8_t xyzMessage[3] = {'X', 'Y', 'Z'};
+static uint8_t rotMessage[3] = {'R', 'O', 'T'};
+static uint8_t VonMessage[3] = {'V', 'O', 'N'};
+static uint8_t VoffMessage[4] = {'V', 'O', 'F', 'F'};
+
+// Key action table indexed by event bit position - built from ASC_KEY_ACTION_TABLE
+#define ASC_KEY_ACTION_ENTRY(bit, xPos, yPos, curX, curY, type, operation) \
+  [bit] = { .x = xPos, .y = yPos, .cursorX = curX, .cursorY = curY, .packetType = type, .op = operation },
+
+static const ASC_KeyAction ascKeyActions[ASC_KEY_COUNT] = {
+  ASC_KEY_ACTION_TABLE(ASC_KEY_ACTION_ENTRY)
+};
+
+static void ascsys_issue_command(uint8_t type, const ASC_GantryState *gantry);
+static void ascsys_send_packet(const uint8_t *execPacket, uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE]);
+static void ascsys_oled_show(OLED_ASCMessage *SendValues, const ASC_GantryState *gantry);
+static void ascsys_oled_progress(void);
+static void ascsys_wait_motion(void);
+static void ascsys_traj_queue(uint8_t x, uint8_t y, uint8_t z);
+static void ascsys_traj_tick(void);
+static void ascsys_traj_flush(void);
+static int ascsys_jog_sample(int32_t *velX, int32_t *velY);
+static void ascsys_run_jobs(const ASC_PlannerJobList *jobLists, int count);
+static int ascsys_plan_step(ASC_PlanCursor *cursor, ASC_GantryState *gantry);
+static ASC_GantryState *ascsys_select(uint8_t target);
+static void ascsys_macro_control(uint8_t request);
+static int ascsys_macro_step(ASC_GantryState *gantry);
+static int ascsys_macro_save(void);
+static void ascsys_macro_load(void);
 
 /**
  * @brief Initialises LED's for task requirements
@@ -41,6 +125,8 @@ void s4741858_reg_ascsys_hardware_init(){
 
   BRD_debuguart_init();
 
+  s4741858_reg_joystick_init(); // ADC1 / ADC2 for jog
+
 	taskEXIT_CRITICAL();
 
 }
@@ -65,24 +151,46 @@ void s4741858_TaskAscFSMcontroller( void ) {
   // INIT STUFF -----------------------------------------------------
   // KEYPAD TASK VARIABLES
   EventBits_t keypadBits;
+  Keypad_Event keyEvent;
+  uint8_t keyBlocked = 0; // move target outside the workspace
+  uint8_t request;        // macro request taken from another task
 
   // KEYPAD VARIABLES / STRUCT
-  OLED_ASCMessage SendValues;
-  uint8_t z = 0; // default values
-  uint8_t x = 0;
-  uint8_t y = 0;
-  uint8_t angle = 0;
-  uint8_t vacumStatus = 0;
-
-  // RADIO QUEUE MESSAGE DECLARATIONS
-  uint8_t senderAdress[4] = {0x47, 0x41, 0x85, 0x89};
-  uint8_t xyzMessage[3] = {'X', 'Y', 'Z'};
-  uint8_t rotMessage[3] = {'R', 'O', 'T'};
-  uint8_t VonMessage[3] = {'V', 'O', 'N'};
-  uint8_t VoffMessage[4] = {'V', 'O', 'F', 'F'};
+  ASC_GantryState *gantry = &gantries[0]; // active rig, default values
+
+  // PLANNER JOB LISTS - one per rig, static, too large for the task stack
+  static ASC_PlannerJobList jobLists[RADIO_MAX_TARGETS];
+  int jobListCount = 0;
+
+  // JOG VARIABLES - fixed point position for sub unit velocity
+  ASC_Coord jogPosX = 0;
+  ASC_Coord jogPosY = 0;
+  int32_t jogVelX = 0;
+  int32_t jogVelY = 0;
+  uint32_t jogCentredMs = 0;
+  uint32_t jogLastTx = 0;
+  TickType_t jogWakeTick = 0;
 
   s4741858_reg_ascsys_hardware_init(); // hardware 
 
+  // Create planner queue - one job list per rig in flight at a time
+  s4741858QueuePlannerJobs = xQueueCreate(RADIO_MAX_TARGETS, sizeof(ASC_PlannerJobList));
+
+  ascsys_macro_load(); // last saved macro survives reset
+
+  // Soft limits - Z and angle steps saturate here
+  s4741858_lib_coord_init(&workspace);
+  s4741858_lib_coord_limit(&workspace, COORD_AXIS_X, 0, ASC_XY_MAX);
+  s4741858_lib_coord_limit(&workspace, COORD_AXIS_Y, 0, ASC_XY_MAX);
+  s4741858_lib_coord_limit(&workspace, COORD_AXIS_Z, 0, ASC_Z_MAX);
+  s4741858_lib_coord_limit(&workspace, COORD_AXIS_ANGLE, 0, ASC_ANGLE_MAX);
+
+  // Every gantry assumed idle at home on start up
+  for (int i = 0; i < RADIO_MAX_TARGETS; i++) {
+    s4741858_lib_motion_init(&motionModels[i], HAL_GetTick(), 0, 0, 0, 0);
+  }
+  SendValues.progress = 100;
+
   static int ControllerFsmCurrentstate = INIT_STATE; //INITIAL IDLE STATE
 
   // 1s Tick Timer
@@ -92,9 +200,6 @@ void s4741858_TaskAscFSMcontroller( void ) {
 
   for (;;) {
 
-    // RADIO PACKET (default zero pads)
-    uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE] = {0}; // should be 16 UNENCODED
-
     // FLASH THE GREEN LED - TASK 1
     uint32_t current_tick = HAL_GetTick();
     if (current_tick - previous_tick >= 1000) { // 1 second interval
@@ -114,258 +219,968 @@ void s4741858_TaskAscFSMcontroller( void ) {
       
       // Waits for input from keypad - loops in this state
       case IDLE_STATE:
+
+        NextState = IDLE_STATE; // stays in idle if nothing to do
+        keyPressTick = 0;       // a key that sent nothing is not timed
+
+        ascsys_oled_progress(); // last command may still be moving
+
+        // RIG SWITCH - keypad, jog and macros now drive another gantry
+        if (requestedTarget != activeTarget) {
+          gantry = ascsys_select(requestedTarget);
+          ascsys_oled_show(&SendValues, gantry);
+        }
+
+        // MACRO REQUESTS - taken before any key is read, so a replay never
+        // waits for a press and never swallows one
+        taskENTER_CRITICAL();
+        request = macroRequest;
+        macroRequest = MACRO_REQUEST_NONE;
+        taskEXIT_CRITICAL();
+
+        if (request != MACRO_REQUEST_NONE) {
+          ascsys_macro_control(request);
+        }
+        if (macroReplayMode != MACRO_REPLAY_OFF) {
+          NextState = MACRO_STATE;
+          break;
+        }
+
+        // JOYSTICK DEFLECTED - stream position until centred again
+        if (jogEnabled && ascsys_jog_sample(&jogVelX, &jogVelY)) {
+          jogPosX = gantry->x;
+          jogPosY = gantry->y;
+          jogCentredMs = 0;
+          jogLastTx = 0;
+          jogWakeTick = xTaskGetTickCount();
+          jogActive = 1;
+          NextState = JOG_STATE;
+          break;
+        }
+
+        // SUBMITTED JOB LISTS - take over from keypad until done, at most
+        // one per rig so lists for different rigs run interleaved
+        jobListCount = 0;
+        while ((s4741858QueuePlannerJobs != NULL) && (jobListCount < RADIO_MAX_TARGETS) &&
+            (xQueuePeek(s4741858QueuePlannerJobs, &jobLists[jobListCount], 0) == pdTRUE)) {
+          int busy = 0;
+
+          for (int i = 0; i < jobListCount; i++) {
+            busy |= (jobLists[i].target == jobLists[jobListCount].target);
+          }
+          if (busy) {
+            break; // same rig again - waits for the next plan
+          }
+          xQueueReceive(s4741858QueuePlannerJobs, &jobLists[jobListCount], 0);
+          jobListCount++;
+        }
+        if (jobListCount != 0) {
+          NextState = PLANNING_STATE;
+          break;
+        }
         
+        // KEY EVENT RING - one action per pass, in the order pressed, held
+        // A / B / C repeat so Z and angle ramp. UP / LONG events carry no
+        // action and are dropped here without costing a pass
+        while ((NextState == IDLE_STATE) && s4741858_reg_keypad_event_get(&keyEvent)) {
+          if ((keyEvent.type == KEYPAD_EVENT_DOWN) || (keyEvent.type == KEYPAD_EVENT_REPEAT)) {
+            BRD_LEDRedToggle(); // SYSTEM STATUS INDICATOR
+            NextState = DISPLAYING_STATE;
+
+            pendingKeyBits = s4741858_reg_keypad_event_bit(keyEvent.key);
+            keyPressTick = keyEvent.tick;
+          }
+        }
+        if (NextState != IDLE_STATE) {
+          break;
+        }
+
         if (keypadctrlEventGroup != NULL) {
-          // WAIT FOR THE KEYPAD BITS
-          keypadBits = xEventGroupWaitBits(keypadctrlEventGroup, KEYPAD_PRESS_EVENT, pdTRUE, pdFALSE, 10);
+          // WAIT FOR THE KEYPAD BITS - the only idle pacing, a ring push or
+          // key bit wakes it straight away so keys never queue behind a sleep
+          keypadBits = xEventGroupWaitBits(keypadctrlEventGroup, KEYPAD_PRESS_EVENT | EVT_KEY_RING, pdTRUE, pdFALSE,
+              pdMS_TO_TICKS(ASC_IDLE_WAIT_MS));
 
-          // SETS CURRENT KEYPAD VALUE FOR REST OF STATE  ACHINE
-          if (keypadBits != 0) {
+          // LATCH EVERY KEY SET SINCE LAST WAIT - processed as one batch
+          if ((keypadBits & KEYPAD_PRESS_EVENT) != 0) {
             BRD_LEDRedToggle(); // SYSTEM STATUS INDICATOR
             NextState = DISPLAYING_STATE; // Next state only if keypad pressed!
 
-            // Sets the global variable keypad value for next states
-            switch(keypadBits) {
-              
-              case EVT_KEY_1:
-                currentKeypadValue = EVT_KEY_1; 
-                break;
-              case EVT_KEY_2:
-                currentKeypadValue = EVT_KEY_2;    
-                break;   
-              case EVT_KEY_3:
-                currentKeypadValue = EVT_KEY_3;
-                break;       
-              case EVT_KEY_4:
-                currentKeypadValue = EVT_KEY_4;
-                break;
-              case EVT_KEY_5:
-                currentKeypadValue = EVT_KEY_5;
-                break;
-              case EVT_KEY_6:
-                currentKeypadValue = EVT_KEY_6;
-                break;
-              case EVT_KEY_7:
-                currentKeypadValue = EVT_KEY_7;
-                break;
-              case EVT_KEY_8:
-                currentKeypadValue = EVT_KEY_8;
-                break;
-              case EVT_KEY_9:
-                currentKeypadValue = EVT_KEY_9;
-                break;
-              case EVT_KEY_A:
-                currentKeypadValue = EVT_KEY_A;
-                break;
-              case EVT_KEY_B:
-                currentKeypadValue = EVT_KEY_B;
-                break;
-              case EVT_KEY_C:
-                currentKeypadValue = EVT_KEY_C;
-                break;
-              case EVT_KEY_0:
-                currentKeypadValue = EVT_KEY_0;
-                break;
-
-              // Add extension keys if attempted           
-            }
-          
-          } else {
-            NextState = IDLE_STATE; // stays in idle if no key pressed
-          }       
-        }  
+            pendingKeyBits = keypadBits & KEYPAD_PRESS_EVENT;
+            keyPressTick = HAL_GetTick(); // edge tick not carried by the bits
+          }
+        } else {
+          vTaskDelay(pdMS_TO_TICKS(ASC_IDLE_WAIT_MS)); // no keypad task to wait on
+        }
         break; // next state
 
       // Co-ordinates with OLED task
       case DISPLAYING_STATE:
 
+        // Pop lowest pending key - O(1) table lookup
+        currentKeyAction = s4741858_ascsys_key_action(pendingKeyBits);
+        pendingKeyBits &= pendingKeyBits - 1; // clear lowest set bit
+
         // Check Queue Exists - Send Display Values
         if (s4741858QueueOLEDMessage != NULL) {
 
-          // Send messages varied acording to keypress  
-          SendValues.string = "+";     
-          switch (currentKeypadValue) {
-            case EVT_KEY_1:
-              SendValues.cursorXLocation = 1; // corresponds to top left
-              SendValues.cursorYLocation = 3; // [0, 150]
-              x = 0;
-              y = 150;
-              break;             
-            case EVT_KEY_2:
-              SendValues.cursorXLocation = 12; // corresponds to top middle
-              SendValues.cursorYLocation = 3; // [75, 150]
-              x = 75;
-              y = 150;
-              break;  
-            case EVT_KEY_3:
-              SendValues.cursorXLocation = 25; // corresponds to 
-              SendValues.cursorYLocation = 3; // [150, 150]
-              y = 150; 
-              x = 150;
-              break; 
-            case EVT_KEY_A:
-              if (z >= 10) {
-                z = z - 10; // change z position
+          // Apply table action to the gantry state
+          SendValues.marker = OLED_MARKER_CROSS;
+          keyBlocked = 0;
+          switch (currentKeyAction->op) {
+            case ASC_OP_MOVE:
+              // Targets in a keep-out zone or past a soft limit are dropped
+              if (!s4741858_lib_coord_allowed(&workspace, COORD_FROM_INT(currentKeyAction->x), COORD_FROM_INT(currentKeyAction->y))) {
+                keyBlocked = 1;
+                break;
               }
-              break;  
-            case EVT_KEY_4:
-              SendValues.cursorXLocation = 1; // corresponds to middle left
-              SendValues.cursorYLocation = 13; // [0, 75]    
-              x = 0;
-              y = 75;   
+              SendValues.cursorXLocation = currentKeyAction->cursorX;
+              SendValues.cursorYLocation = currentKeyAction->cursorY;
+              gantry->x = COORD_FROM_INT(currentKeyAction->x);
+              gantry->y = COORD_FROM_INT(currentKeyAction->y);
               break;
-            case EVT_KEY_5:
-              SendValues.cursorXLocation = 13; // corresponds to middle left
-              SendValues.cursorYLocation = 13; // [75, 75] 
-              x = 75;
-              y = 75;      
-              break; 
-            case EVT_KEY_6:
-              SendValues.cursorXLocation = 25; // corresponds to middle left
-              SendValues.cursorYLocation = 13; // [150, 75]  
-              x = 150;
-              y = 75;     
+            case ASC_OP_ZDOWN:
+              gantry->z = s4741858_lib_coord_add(&workspace, COORD_AXIS_Z, gantry->z, -COORD_FROM_INT(ASC_Z_STEP));
               break;
-            case EVT_KEY_B:
-              if (z <= 80) { 
-                z += 10; 
-              } 
+            case ASC_OP_ZUP:
+              gantry->z = s4741858_lib_coord_add(&workspace, COORD_AXIS_Z, gantry->z, COORD_FROM_INT(ASC_Z_STEP));
               break;
-            case EVT_KEY_7:
-              SendValues.cursorXLocation = 1; // corresponds to bottom left
-              SendValues.cursorYLocation = 23; // [0, 0] 
-              x = 0;
-              y = 0;
+            case ASC_OP_ROTATE:
+              gantry->angle = s4741858_lib_coord_add(&workspace, COORD_AXIS_ANGLE, gantry->angle, COORD_FROM_INT(ASC_ANGLE_STEP));
               break;
-            case EVT_KEY_8:
-              SendValues.cursorXLocation = 13; // corresponds to bottom middle
-              SendValues.cursorYLocation = 23; // [75, 0] 
-              x = 75;
-              y = 0;
+            case ASC_OP_VACUUM:
+              gantry->vacumStatus ^= 0xFF; // TOGGLE VACCUM (bitwise)
               break; 
-            case EVT_KEY_9:
-              SendValues.cursorXLocation = 25; // corresponds to bottom right
-              SendValues.cursorYLocation = 23; // [150, 0]
-              x = 150;
-              y = 0; 
+            case ASC_OP_MACRO_REC:
+              ascsys_macro_control(macroRecording ? MACRO_REQUEST_STOP : MACRO_REQUEST_RECORD);
               break;
-            case EVT_KEY_C:
-              if (angle <= 170) {
-                angle += 10;
-              }
+            case ASC_OP_MACRO_PLAY:
+              ascsys_macro_control(MACRO_REQUEST_PACE);
+              break;
+            case ASC_OP_MACRO_FAST:
+              ascsys_macro_control(MACRO_REQUEST_FAST);
               break;
-            case EVT_KEY_0:
-              vacumStatus ^= 0xFF; // TOGGLE VACCUM (bitwise)
-              break; 
-                                         
           } 
           NextState = TRANSMITTING_STATE;
+
+          // Controller only keys and blocked moves send nothing
+          if ((currentKeyAction->packetType == NO_TYPE) || keyBlocked) {
+            NextState = (pendingKeyBits != 0) ? DISPLAYING_STATE : IDLE_STATE;
+          }
+
+          // Replay takes over - rest of the batch is dropped
+          if (macroReplayMode != MACRO_REPLAY_OFF) {
+            pendingKeyBits = 0;
+            NextState = MACRO_STATE;
+          }
           
           
-          SendValues.z = z; // sends according to updated value
-          SendValues.angle = angle;
+          SendValues.x = COORD_TO_INT(gantry->x);
+          SendValues.y = COORD_TO_INT(gantry->y);
+          SendValues.z = COORD_TO_INT(gantry->z); // sends according to updated value
+          SendValues.angle = COORD_TO_INT(gantry->angle);
 
-          //send to OLED mylib task
-          xQueueSend(s4741858QueueOLEDMessage, &SendValues, 10);
+          //send to OLED mylib task - once per batch, only final state matters
+          if (pendingKeyBits == 0) {
+            xQueueOverwrite(s4741858QueueOLEDMessage, &SendValues);
+          }
         }
         break;
 
       // Sends Radio Package to NRF
       case TRANSMITTING_STATE:
 
-        // DECLARATION ERROR - filler code
-        sendRadioPacket[0] = 0x00;
-
-        // RADIO POSITION VARIABLES
-        uint8_t ascXpos[3] = {0};
-        uint8_t ascYpos[3] = {0};
-        int8_t ascZpos[2] = {0};
+        // Check Queue Exists
+        if (s4741858QueueRadioTXMessage != NULL) {
+          ascsys_issue_command(currentKeyAction->packetType, gantry);
+        }
+          
+        // drain rest of batch before waiting on keypad again
+        if (pendingKeyBits != 0) {
+          NextState = DISPLAYING_STATE;
+        } else {
+          NextState = IDLE_STATE; // automatic transition back to idle
+        }
+        break;
 
-        // FIll in position from OLED - CONVERT TO ASCII
-        ascXpos[0] = (x / 100) % 10 + '0'; // calculate hundreds digit
-        ascXpos[1] = (x / 10) % 10 + '0';  // calculate tens digit
-        ascXpos[2] = x % 10 + '0';         // calculate ones digit
-        ascYpos[0] = (y / 100) % 10 + '0';
-        ascYpos[1] = (y / 10) % 10 + '0';
-        ascYpos[2] = y % 10 + '0';
-        ascZpos[0] = (z / 10) % 10 + '0';
-        ascZpos[1] = z % 10 + '0';        
+      // Orders the submitted jobs and sends the whole sequence
+      case PLANNING_STATE:
 
-        // Check Queue Exists
         if (s4741858QueueRadioTXMessage != NULL) {
-          // Fill queue according to message type - default zero padded
-          switch (currentKeypadValue) {
-           
-           // XYZ PACKET TYPE
-            case EVT_KEY_1:
-            case EVT_KEY_2:
-            case EVT_KEY_3:
-            case EVT_KEY_A:
-            case EVT_KEY_4:
-            case EVT_KEY_5:   
-            case EVT_KEY_6:
-            case EVT_KEY_B: 
-            case EVT_KEY_7:
-            case EVT_KEY_8:
-            case EVT_KEY_9:
-
-              sendRadioPacket[0] = XYZ_TYPE; // packet type
-
-              editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
-
-              editRadioPacket(sendRadioPacket, 5, xyzMessage, 3); // xyz payload
-
-              editRadioPacket(sendRadioPacket, 8, ascXpos, 3);  // x-pos
-              editRadioPacket(sendRadioPacket, 11, ascYpos, 3); // y-pos
-              editRadioPacket(sendRadioPacket, 14, ascZpos, 2); // z-pos
-              break;             
-
-            // ANGLE ROTATION PACKET TYPE
-            case EVT_KEY_C: 
-              sendRadioPacket[0] = ROT_TYPE;
-              editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
-
-              editRadioPacket(sendRadioPacket, 5, rotMessage, 3); // angle payload
-
-              uint8_t ascAngle[3] = {0};
-              ascAngle[0] = (angle / 100) % 10 + '0'; // calculate hundreds digit
-              ascAngle[1] = (angle / 10) % 10 + '0';  // calculate tens digit
-              ascAngle[2] = angle % 10 + '0';         // calculate ones digit
-              editRadioPacket(sendRadioPacket, 8, ascAngle, 3); // angle value
-              
-              break;
+          ascsys_run_jobs(jobLists, jobListCount);
+        }
 
-            // VACUUM PACKET TYPE
-            case EVT_KEY_0:
-              sendRadioPacket[0] = VAC_TYPE;
-              editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
-              if (vacumStatus == 0) {
-                editRadioPacket(sendRadioPacket, 5, VoffMessage, 4); // vacuum off
-              } else {
-                editRadioPacket(sendRadioPacket, 5, VonMessage, 3); // vacuum on
-              }
+        // Show where the batch left the gantry
+        ascsys_oled_show(&SendValues, gantry);
+
+        NextState = IDLE_STATE;
+        break;
 
-              break;                                          
-          }          
-          // send un-encoded packet to the radio mylib task
-          xQueueSend(s4741858QueueRadioTXMessage, &sendRadioPacket, 10);
-          BRD_LEDBlueToggle();
-          // circular change
+      // Replays the macro - keypad and debounce path not read at all
+      case MACRO_STATE:
+
+        if ((s4741858QueueRadioTXMessage != NULL) && ascsys_macro_step(gantry)) {
+          NextState = MACRO_STATE;
+          break;
+        }
+
+        macroReplayMode = MACRO_REPLAY_OFF;
+
+        // Discard anything pressed while replaying
+        if (keypadctrlEventGroup != NULL) {
+          xEventGroupClearBits(keypadctrlEventGroup, KEYPAD_PRESS_EVENT | EVT_KEY_RING);
+        }
+        s4741858_reg_keypad_event_flush();
+
+        ascsys_oled_show(&SendValues, gantry);
+
+        NextState = IDLE_STATE;
+        break;
+
+      // Streams joystick position at a fixed rate - keys wait in event group / ring
+      case JOG_STATE:
+
+        NextState = JOG_STATE;
+        vTaskDelayUntil(&jogWakeTick, pdMS_TO_TICKS(JOG_SAMPLE_PERIOD));
+
+        if (ascsys_jog_sample(&jogVelX, &jogVelY)) {
+          jogCentredMs = 0;
+        } else {
+          jogCentredMs += JOG_SAMPLE_PERIOD;
+        }
+
+        // INTEGRATE VELOCITY - saturated at the limits, slides along keep-out edges
+        s4741858_lib_coord_step(&workspace, &jogPosX, &jogPosY,
+            (jogVelX * COORD_ONE * JOG_SAMPLE_PERIOD) / 1000, (jogVelY * COORD_ONE * JOG_SAMPLE_PERIOD) / 1000);
+
+        if (jogCentredMs >= JOG_EXIT_MS) {
+          NextState = IDLE_STATE;
+        }
+
+        // RATE LIMITED, DELTA COALESCED - final position always flushed
+        if ((NextState == IDLE_STATE) || (HAL_GetTick() - jogLastTx >= JOG_TX_PERIOD)) {
+          int newX = COORD_TO_INT(jogPosX);
+          int newY = COORD_TO_INT(jogPosY);
+
+          if ((abs(newX - COORD_TO_INT(gantry->x)) >= JOG_MIN_DELTA) || (abs(newY - COORD_TO_INT(gantry->y)) >= JOG_MIN_DELTA)) {
+            gantry->x = jogPosX;
+            gantry->y = jogPosY;
+            if (s4741858QueueRadioTXMessage != NULL) {
+              ascsys_issue_command(XYZ_TYPE, gantry);
+            }
+            ascsys_oled_show(&SendValues, gantry);
+            jogLastTx = HAL_GetTick();
+          }
+        }
+
+        if (NextState == IDLE_STATE) {
+          jogActive = 0;
         }
-          
-        NextState = IDLE_STATE; // automatic transition back to idle
         break;
     }
 
     ControllerFsmCurrentstate = NextState; // DO THE STATE CHANGE
     
-  // Delay Length?????
-  vTaskDelay(50);
+  // IDLE_STATE paces itself on the keypad wait, a batch runs back to back
+  if (NextState == IDLE_STATE) {
+    ascsys_traj_flush(); // batch moves blend, finish them before waiting
+  }
 
   }
   
 }
 
+/**
+ * @brief Submits a pick and place job list to the controller. The
+ * list is copied so the caller's buffer may be reused straight away.
+ * @param jobList jobs to plan, count <= PLANNER_MAX_JOBS
+ * @return 1 if accepted, 0 if a list is already waiting, invalid or
+ * touches a keep-out zone
+ */
+extern int s4741858_ascsys_submit_jobs(const ASC_PlannerJobList *jobList) {
+
+  if ((s4741858QueuePlannerJobs == NULL) || (jobList->count == 0) || (jobList->count > PLANNER_MAX_JOBS) ||
+      (jobList->target >= s4741858_txradio_targets())) {
+    return 0;
+  }
+
+  // Whole list refused if any pick or place point is off limits
+  for (int n = 0; n < jobList->count; n++) {
+    const ASC_PlannerJob *job = &jobList->jobs[n];
+
+    if (!s4741858_lib_coord_allowed(&workspace, COORD_FROM_INT(job->pickX), COORD_FROM_INT(job->pickY)) ||
+        !s4741858_lib_coord_allowed(&workspace, COORD_FROM_INT(job->placeX), COORD_FROM_INT(job->placeY))) {
+      return 0;
+    }
+  }
+
+  return (xQueueSend(s4741858QueuePlannerJobs, jobList, 0) == pdTRUE);
+
+}
+
+/**
+ * @brief Plans the job order of every list then emits move, Z-down,
+ * vacuum, Z-up for each pick and place straight into the radio queues.
+ * With several rigs the next command always goes to the rig the motion
+ * models say is ready first, so all gantries work at once - INTERNAL
+ */
+static void ascsys_run_jobs(const ASC_PlannerJobList *jobLists, int count) {
+
+  ASC_PlanCursor cursor[RADIO_MAX_TARGETS];
+  uint8_t home = activeTarget;
+  int remaining = count;
+  int turn = 0;
+
+  for (int i = 0; i < count; i++) {
+    ASC_GantryState *gantry = ascsys_select(jobLists[i].target);
+
+    cursor[i].jobList = &jobLists[i];
+    cursor[i].job = 0;
+    cursor[i].step = 0;
+    s4741858_lib_planner_order(&jobLists[i], COORD_TO_INT(gantry->x), COORD_TO_INT(gantry->y), cursor[i].order);
+  }
+
+  // Waypoint streaming would hold the other rigs for a whole move
+  planInterleaved = (count > 1);
+
+  while (remaining > 0) {
+    int best = -1;
+    uint32_t bestWait = 0;
+
+    // READIEST RIG - ties go round robin from the last one served
+    for (int k = 0; k < count; k++) {
+      int i = (turn + k) % count;
+      uint32_t wait;
+
+      if (cursor[i].job >= jobLists[i].count) {
+        continue;
+      }
+      wait = s4741858_lib_motion_release(&motionModels[jobLists[i].target], HAL_GetTick());
+      if ((best < 0) || (wait < bestWait)) {
+        best = i;
+        bestWait = wait;
+      }
+    }
+    turn = best + 1;
+
+    if (!ascsys_plan_step(&cursor[best], ascsys_select(jobLists[best].target))) {
+      remaining--;
+    }
+  }
+
+  planInterleaved = 0;
+  ascsys_select(home);
+
+}
+
+/**
+ * @brief Issues the next command of one job list - pick then place,
+ * each move at travel height, Z down, vacuum, Z up - INTERNAL
+ * @return 1 while the list has commands left
+ */
+static int ascsys_plan_step(ASC_PlanCursor *cursor, ASC_GantryState *gantry) {
+
+  const ASC_PlannerJob *job = &cursor->jobList->jobs[cursor->order[cursor->job]];
+  int leg = cursor->step / 4; // 0 pick, 1 place
+
+  switch (cursor->step % 4) {
+    case 0:
+      gantry->x = COORD_FROM_INT((leg == 0) ? job->pickX : job->placeX);
+      gantry->y = COORD_FROM_INT((leg == 0) ? job->pickY : job->placeY);
+      gantry->z = s4741858_lib_coord_clamp(&workspace, COORD_AXIS_Z, COORD_FROM_INT(PLANNER_Z_TRAVEL));
+      ascsys_issue_command(XYZ_TYPE, gantry); // move
+      break;
+    case 1:
+      gantry->z = s4741858_lib_coord_clamp(&workspace, COORD_AXIS_Z, COORD_FROM_INT(PLANNER_Z_PICK));
+      ascsys_issue_command(XYZ_TYPE, gantry); // z down
+      break;
+    case 2:
+      gantry->vacumStatus = (leg == 0) ? 0xFF : 0x00;
+      ascsys_issue_command(VAC_TYPE, gantry); // vacuum
+      break;
+    case 3:
+      gantry->z = s4741858_lib_coord_clamp(&workspace, COORD_AXIS_Z, COORD_FROM_INT(PLANNER_Z_TRAVEL));
+      ascsys_issue_command(XYZ_TYPE, gantry); // z up
+      break;
+  }
+
+  if (++cursor->step == 8) {
+    cursor->step = 0;
+    cursor->job++;
+  }
+
+  return cursor->job < cursor->jobList->count;
+}
+
+/**
+ * @brief Makes a rig the active one - its gantry state, motion model
+ * and radio queue are used from here on. Moves still streaming to the
+ * previous rig are finished first - INTERNAL
+ * @return the rig's gantry state
+ */
+static ASC_GantryState *ascsys_select(uint8_t target) {
+
+  if (target != activeTarget) {
+    ascsys_traj_flush();
+    activeTarget = target;
+    motion = &motionModels[target];
+  }
+
+  return &gantries[target];
+}
+
+/**
+ * @brief Chooses the rig the keypad, jog and macros drive, taken up by
+ * the controller next time it is idle.
+ * @param target row of the myconfig.h target table
+ * @return 1 if accepted, 0 if no such rig
+ */
+extern int s4741858_ascsys_select_target(int target) {
+
+  if ((target < 0) || (target >= s4741858_txradio_targets())) {
+    return 0;
+  }
+
+  requestedTarget = target;
+  return 1;
+}
+
+/**
+ * @brief Copies the last commanded state of one rig.
+ */
+extern void s4741858_ascsys_target_state(int target, ASC_GantryState *state) {
+
+  if ((target >= 0) && (target < RADIO_MAX_TARGETS)) {
+    *state = gantries[target];
+  }
+
+}
+
+/**
+ * @brief Builds and queues the packet for one resolved command from
+ * the gantry state, recording it when a macro is being recorded - INTERNAL
+ */
+static void ascsys_issue_command(uint8_t type, const ASC_GantryState *gantry) {
+
+  // RADIO PACKET (default zero pads)
+  uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE] = {0}; // should be 16 UNENCODED
+
+  // Whole units - what goes on air, the model and the macro
+  uint8_t x = COORD_TO_INT(gantry->x);
+  uint8_t y = COORD_TO_INT(gantry->y);
+  uint8_t z = COORD_TO_INT(gantry->z);
+  uint8_t angle = COORD_TO_INT(gantry->angle);
+
+  // Fill queue according to message type - default zero padded
+  switch (type) {
+
+    // XYZ PACKET TYPE
+    case XYZ_TYPE:
+      s4741858_ascsys_xyz_packet(sendRadioPacket, x, y, z);
+      break;
+
+    // ANGLE ROTATION PACKET TYPE
+    case ROT_TYPE:
+      s4741858_ascsys_rot_packet(sendRadioPacket, angle);
+      break;
+
+    // VACUUM PACKET TYPE
+    case VAC_TYPE:
+      s4741858_ascsys_vac_packet(sendRadioPacket, gantry->vacumStatus);
+      break;
+
+    default:
+      return;
+  }
+
+  // EVENT LOG - commands only, jog streams too fast to read
+  if (!jogActive) {
+    char line[OLED_LOG_CHARS + 1];
+
+    if (type == XYZ_TYPE) {
+      snprintf(line, sizeof(line), "R%d XYZ %u %u %u", activeTarget, x, y, z);
+    } else if (type == ROT_TYPE) {
+      snprintf(line, sizeof(line), "R%d ROT %u", activeTarget, angle);
+    } else {
+      snprintf(line, sizeof(line), "R%d VAC %s", activeTarget, gantry->vacumStatus ? "ON" : "OFF");
+    }
+    s4741858_oled_log(line);
+  }
+
+  if ((type == XYZ_TYPE) && trajEnabled && !jogActive && !planInterleaved) {
+
+    // Interpolated - waypoints released by ascsys_traj_tick
+    ascsys_traj_queue(x, y, z);
+
+  } else if (jogActive) {
+
+    // Streaming - jog rate limit paces the gantry, model just follows
+    ascsys_send_packet(NULL, sendRadioPacket);
+    s4741858_lib_motion_issue(motion, HAL_GetTick(), x, y, z, angle, 0);
+
+  } else if (scheduleEnabled && s4741858_txradio_time_synced(activeTarget)) {
+
+    ascsys_traj_flush(); // queued moves land first
+
+    // Send ahead - EXEC packet carries the tick the model says this starts
+    uint8_t execPacket[TASK_RADIO_PACKET_SIZE] = {0};
+
+    s4741858_lib_motion_issue(motion, HAL_GetTick() + MOTION_RELEASE_LEAD_MS, x, y, z, angle,
+        (type == VAC_TYPE) ? MOTION_VAC_SETTLE_MS : 0);
+    s4741858_ascsys_exec_packet(execPacket, motion->startTick);
+    ascsys_send_packet(execPacket, sendRadioPacket); // one item, nothing lands between
+
+  } else {
+
+    // Release once the model says the previous command is finishing
+    ascsys_traj_flush();
+    ascsys_wait_motion();
+    ascsys_send_packet(NULL, sendRadioPacket);
+    s4741858_lib_motion_issue(motion, HAL_GetTick(), x, y, z, angle,
+        (type == VAC_TYPE) ? MOTION_VAC_SETTLE_MS : 0);
+  }
+
+  // MACRO RECORD - ring buffer, oldest command overwritten when full
+  if (macroRecording) {
+    uint32_t now = HAL_GetTick();
+    ASC_MacroCommand *cmd = &macroBuffer[macroHead];
+
+    cmd->type = type;
+    cmd->x = x;
+    cmd->y = y;
+    cmd->z = z;
+    cmd->angle = angle;
+    cmd->vacumStatus = gantry->vacumStatus;
+    cmd->delayMs = (macroCount == 0) ? 0 : ((now - macroLastTick > 0xFFFF) ? 0xFFFF : (now - macroLastTick));
+    macroLastTick = now;
+
+    macroHead = (macroHead + 1) % MACRO_MAX_COMMANDS;
+    if (macroCount < MACRO_MAX_COMMANDS) {
+      macroCount++;
+    }
+  }
+
+}
+
+/**
+ * @brief Requests macro recording start or stop. Starting clears the
+ * ring, stopping persists it to flash - both done by the controller
+ * the next time it is idle.
+ * @param enable 1 to record, 0 to stop
+ */
+extern void s4741858_ascsys_macro_record(int enable) {
+  macroRequest = enable ? MACRO_REQUEST_RECORD : MACRO_REQUEST_STOP;
+}
+
+/**
+ * @brief Requests replay of the recorded macro, started by the
+ * controller the next time it is idle. Stops any recording first.
+ * @param mode MACRO_REPLAY_PACE or MACRO_REPLAY_FAST
+ */
+extern void s4741858_ascsys_macro_replay(int mode) {
+  macroRequest = (mode == MACRO_REPLAY_FAST) ? MACRO_REQUEST_FAST : MACRO_REQUEST_PACE;
+}
+
+/**
+ * @brief Acts on a macro request - controller task only, it is the one
+ * appending to the ring. Stop and replay both end a recording and save
+ * it first. - INTERNAL
+ * @param request MACRO_REQUEST_*
+ */
+static void ascsys_macro_control(uint8_t request) {
+
+  if ((request == MACRO_REQUEST_RECORD) && !macroRecording) {
+    macroHead = 0;
+    macroCount = 0;
+    macroRecording = 1;
+    BRD_LEDRedOn(); // RECORDING INDICATOR
+  } else if ((request != MACRO_REQUEST_RECORD) && macroRecording) {
+    macroRecording = 0;
+    BRD_LEDRedOff();
+    if (!ascsys_macro_save()) {
+      s4741858_oled_log("MACRO SAVE FAILED");
+    }
+  }
+
+  if (((request == MACRO_REQUEST_PACE) || (request == MACRO_REQUEST_FAST)) && (macroCount != 0)) {
+    macroReplayIndex = 0;
+    macroReplayMode = (request == MACRO_REQUEST_FAST) ? MACRO_REPLAY_FAST : MACRO_REPLAY_PACE;
+  }
+
+}
+
+/**
+ * @brief Issues the next macro command, waiting out its recorded delay
+ * in paced mode. Fast mode is limited by the blocking radio queue.
+ * @return 1 if a command was issued, 0 when the macro is finished
+ */
+static int ascsys_macro_step(ASC_GantryState *gantry) {
+
+  if (macroReplayIndex >= macroCount) {
+    return 0;
+  }
+
+  // oldest first - ring may have wrapped
+  const ASC_MacroCommand *cmd = &macroBuffer[(macroHead + MACRO_MAX_COMMANDS - macroCount + macroReplayIndex) % MACRO_MAX_COMMANDS];
+  macroReplayIndex++;
+
+  if ((macroReplayMode == MACRO_REPLAY_PACE) && (cmd->delayMs != 0)) {
+    ascsys_traj_flush(); // recorded gap starts once the gantry stops
+    vTaskDelay(pdMS_TO_TICKS(cmd->delayMs));
+  }
+
+  // Recorded before the current limits - blocked moves are skipped
+  if (!s4741858_lib_coord_allowed(&workspace, COORD_FROM_INT(cmd->x), COORD_FROM_INT(cmd->y))) {
+    return 1;
+  }
+
+  gantry->x = COORD_FROM_INT(cmd->x);
+  gantry->y = COORD_FROM_INT(cmd->y);
+  gantry->z = s4741858_lib_coord_clamp(&workspace, COORD_AXIS_Z, COORD_FROM_INT(cmd->z));
+  gantry->angle = s4741858_lib_coord_clamp(&workspace, COORD_AXIS_ANGLE, COORD_FROM_INT(cmd->angle));
+  gantry->vacumStatus = cmd->vacumStatus;
+  ascsys_issue_command(cmd->type, gantry);
+
+  return 1;
+}
+
+/**
+ * @brief Writes the macro to flash oldest first - magic, count, then
+ * two words per command. Sector erase blocks this task (~1s). The
+ * commands are programmed first and the count and magic only once they
+ * all went in, so an interrupted or failed save never loads - the
+ * magic word is still erased.
+ * @return 1 if the whole macro was written
+ */
+static int ascsys_macro_save(void) {
+
+  FLASH_EraseInitTypeDef erase = {0};
+  uint32_t sectorError;
+  uint32_t address = MACRO_FLASH_ADDRESS + 8;
+  uint32_t words[2];
+  int ok = 0;
+
+  erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+  erase.Sector = MACRO_FLASH_SECTOR;
+  erase.NbSectors = 1;
+  erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+  HAL_FLASH_Unlock();
+
+  if (HAL_FLASHEx_Erase(&erase, &sectorError) == HAL_OK) {
+    ok = 1;
+
+    // PAYLOAD - stops at the first word that fails
+    for (int i = 0; ok && (i < macroCount); i++) {
+      memcpy(words, &macroBuffer[(macroHead + MACRO_MAX_COMMANDS - macroCount + i) % MACRO_MAX_COMMANDS], sizeof(words));
+      ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address, words[0]) == HAL_OK) &&
+          (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + 4, words[1]) == HAL_OK);
+      address += 8;
+    }
+
+    // HEADER - magic last, it is what marks the macro valid
+    ok = ok && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, MACRO_FLASH_ADDRESS + 4, macroCount) == HAL_OK);
+    ok = ok && (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, MACRO_FLASH_ADDRESS, MACRO_FLASH_MAGIC) == HAL_OK);
+  }
+
+  HAL_FLASH_Lock();
+
+  return ok;
+}
+
+/**
+ * @brief Loads the saved macro into the ring if the flash holds one.
+ */
+static void ascsys_macro_load(void) {
+
+  const uint32_t *flash = (const uint32_t *) MACRO_FLASH_ADDRESS;
+
+  if ((flash[0] == MACRO_FLASH_MAGIC) && (flash[1] <= MACRO_MAX_COMMANDS)) {
+    macroCount = flash[1];
+    memcpy(macroBuffer, &flash[2], macroCount * sizeof(ASC_MacroCommand));
+    macroHead = macroCount % MACRO_MAX_COMMANDS;
+  }
+
+}
+
+/**
+ * @brief Queues an un-encoded packet to the radio mylib task, blocks
+ * rather than drop - every command must reach air - INTERNAL
+ * @param execPacket EXEC packet to go to air just before it, NULL if none
+ */
+static void ascsys_send_packet(const uint8_t *execPacket, uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE]) {
+
+  TXRadio_QueueItem item;
+
+  memset(item.exec, 0, TASK_RADIO_PACKET_SIZE);
+  if (execPacket != NULL) {
+    memcpy(item.exec, execPacket, TASK_RADIO_PACKET_SIZE);
+  }
+  memcpy(item.packet, sendRadioPacket, TASK_RADIO_PACKET_SIZE);
+  item.keyTick = keyPressTick; // keypress to air latency, first packet only
+  keyPressTick = 0;
+
+  xQueueSend(s4741858QueueRadioTXTarget[activeTarget], &item, portMAX_DELAY);
+  BRD_LEDBlueToggle();
+
+}
+
+/**
+ * @brief Sends the gantry state to the OLED, marker placed from the key
+ * action table or scaled when off grid - INTERNAL
+ */
+static void ascsys_oled_show(OLED_ASCMessage *SendValues, const ASC_GantryState *gantry) {
+
+  if (s4741858QueueOLEDMessage == NULL) {
+    return;
+  }
+
+  SendValues->marker = OLED_MARKER_CROSS;
+
+  // Off grid (jog) - scaled into the box, grid points use the table
+  SendValues->cursorXLocation = ASC_CURSOR_X_MIN + (COORD_TO_INT(gantry->x) * (ASC_CURSOR_X_MAX - ASC_CURSOR_X_MIN)) / ASC_XY_MAX;
+  SendValues->cursorYLocation = ASC_CURSOR_Y_MAX - (COORD_TO_INT(gantry->y) * (ASC_CURSOR_Y_MAX - ASC_CURSOR_Y_MIN)) / ASC_XY_MAX;
+  for (int i = 0; i < ASC_KEY_COUNT; i++) {
+    if ((ascKeyActions[i].op == ASC_OP_MOVE) && (COORD_FROM_INT(ascKeyActions[i].x) == gantry->x) && (COORD_FROM_INT(ascKeyActions[i].y) == gantry->y)) {
+      SendValues->cursorXLocation = ascKeyActions[i].cursorX;
+      SendValues->cursorYLocation = ascKeyActions[i].cursorY;
+      break;
+    }
+  }
+  SendValues->x = COORD_TO_INT(gantry->x);
+  SendValues->y = COORD_TO_INT(gantry->y);
+  SendValues->z = COORD_TO_INT(gantry->z);
+  SendValues->angle = COORD_TO_INT(gantry->angle);
+  SendValues->progress = s4741858_lib_motion_progress(motion, HAL_GetTick());
+
+  xQueueOverwrite(s4741858QueueOLEDMessage, SendValues);
+
+}
+
+/**
+ * @brief Sends predicted progress of the executing command to the OLED,
+ * in 10% steps and only when it changes - INTERNAL
+ */
+static void ascsys_oled_progress(void) {
+
+  int progress = (s4741858_lib_motion_progress(motion, HAL_GetTick()) / 10) * 10;
+
+  if ((s4741858QueueOLEDMessage != NULL) && (progress != SendValues.progress)) {
+    SendValues.progress = progress;
+    xQueueOverwrite(s4741858QueueOLEDMessage, &SendValues);
+  }
+
+}
+
+/**
+ * @brief Blocks until the next command may be released, updating the
+ * OLED progress bar while waiting - INTERNAL
+ */
+static void ascsys_wait_motion(void) {
+
+  uint32_t wait;
+
+  while ((wait = s4741858_lib_motion_release(motion, HAL_GetTick())) != 0) {
+    vTaskDelay(pdMS_TO_TICKS((wait < MOTION_PROGRESS_PERIOD) ? wait : MOTION_PROGRESS_PERIOD));
+    ascsys_oled_progress();
+  }
+
+}
+
+/**
+ * @brief Queues an XYZ move on the trajectory, releasing waypoints
+ * while the look-ahead queue is full. A trajectory from rest starts
+ * where the motion model says the gantry is - INTERNAL
+ */
+static void ascsys_traj_queue(uint8_t x, uint8_t y, uint8_t z) {
+
+  if (s4741858_lib_traj_idle(&traj)) {
+    ascsys_wait_motion(); // vacuum settle, rotation etc. done first
+    // OVERHEAD - the whole trajectory counts as one issued command
+    s4741858_lib_motion_issue(motion, HAL_GetTick(), motion->x, motion->y, motion->z, motion->angle, 0);
+    s4741858_lib_traj_init(&traj, COORD_FROM_INT(motion->x), COORD_FROM_INT(motion->y), COORD_FROM_INT(motion->z));
+    trajWakeTick = xTaskGetTickCount();
+  }
+
+  while (!s4741858_lib_traj_add(&traj, COORD_FROM_INT(x), COORD_FROM_INT(y), COORD_FROM_INT(z))) {
+    ascsys_traj_tick();
+  }
+
+}
+
+/**
+ * @brief Waits out one TRAJ_PERIOD_MS then streams the next waypoint,
+ * skipped when it rounds to the position already sent - INTERNAL
+ */
+static void ascsys_traj_tick(void) {
+
+  uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE] = {0};
+  ASC_Coord pos[TRAJ_AXES];
+  uint8_t x, y, z;
+
+  vTaskDelayUntil(&trajWakeTick, pdMS_TO_TICKS(TRAJ_PERIOD_MS));
+  s4741858_lib_traj_step(&traj, pos);
+
+  x = COORD_TO_INT(pos[0]);
+  y = COORD_TO_INT(pos[1]);
+  z = COORD_TO_INT(pos[2]);
+
+  if ((x != motion->x) || (y != motion->y) || (z != motion->z)) {
+    s4741858_ascsys_xyz_packet(sendRadioPacket, x, y, z);
+    ascsys_send_packet(NULL, sendRadioPacket);
+    s4741858_lib_motion_stream(motion, HAL_GetTick(), x, y, z);
+
+    // PLOT - each waypoint released, the OLED keeps only the newest
+    if (s4741858QueueOLEDMessage != NULL) {
+      SendValues.x = x;
+      SendValues.y = y;
+      SendValues.z = z;
+      xQueueOverwrite(s4741858QueueOLEDMessage, &SendValues);
+    }
+  }
+
+}
+
+/**
+ * @brief Streams waypoints until every queued move is finished - INTERNAL
+ */
+static void ascsys_traj_flush(void) {
+
+  while (!s4741858_lib_traj_idle(&traj)) {
+    ascsys_traj_tick();
+  }
+
+}
+
+/**
+ * @brief Enables interpolated XYZ moves. Off sends each move as a
+ * single jump command, as before.
+ * @param enable 1 on (default), 0 off
+ */
+extern void s4741858_ascsys_trajectory(int enable) {
+  trajEnabled = enable; // queued moves still finish, flushed on idle
+
+}
+
+/**
+ * @brief Samples both joystick axes and maps deflection outside the
+ * deadzone linearly to velocity - INTERNAL
+ * @return 1 if either axis is deflected
+ */
+static int ascsys_jog_sample(int32_t *velX, int32_t *velY) {
+
+  int32_t dx = S4741858_REG_JOYSTICK_X_READ() + S4741858_REG_JOYSTICK_X_ZERO_CAL_OFFSET - JOG_ADC_CENTRE;
+  int32_t dy = S4741858_REG_JOYSTICK_Y_READ() + S4741858_REG_JOYSTICK_Y_ZERO_CAL_OFFSET - JOG_ADC_CENTRE;
+
+  // remove deadzone so speed ramps from zero at its edge
+  dx = (dx > JOG_DEADZONE) ? (dx - JOG_DEADZONE) : ((dx < -JOG_DEADZONE) ? (dx + JOG_DEADZONE) : 0);
+  dy = (dy > JOG_DEADZONE) ? (dy - JOG_DEADZONE) : ((dy < -JOG_DEADZONE) ? (dy + JOG_DEADZONE) : 0);
+
+  *velX = (dx * JOG_MAX_SPEED) / (JOG_ADC_CENTRE - JOG_DEADZONE);
+  *velY = (dy * JOG_MAX_SPEED) / (JOG_ADC_CENTRE - JOG_DEADZONE);
+
+  return (dx != 0) || (dy != 0);
+}
+
+/**
+ * @brief Enables joystick jog - stick deflection in idle streams XYZ.
+ * @param enable 1 on (default), 0 keypad only
+ */
+extern void s4741858_ascsys_jog(int enable) {
+  jogEnabled = enable;
+}
+
+/**
+ * @brief Fills an XYZ packet - type, sender, "XYZ", then x, y as three
+ * ASCII digits and z as two ASCII digits.
+ */
+void s4741858_ascsys_xyz_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint8_t x, uint8_t y, uint8_t z) {
+
+  // RADIO POSITION VARIABLES
+  uint8_t ascXpos[3] = {0};
+  uint8_t ascYpos[3] = {0};
+  uint8_t ascZpos[2] = {0};
+
+  // FIll in position - CONVERT TO ASCII
+  ascXpos[0] = (x / 100) % 10 + '0'; // calculate hundreds digit
+  ascXpos[1] = (x / 10) % 10 + '0';  // calculate tens digit
+  ascXpos[2] = x % 10 + '0';         // calculate ones digit
+  ascYpos[0] = (y / 100) % 10 + '0';
+  ascYpos[1] = (y / 10) % 10 + '0';
+  ascYpos[2] = y % 10 + '0';
+  ascZpos[0] = (z / 10) % 10 + '0';
+  ascZpos[1] = z % 10 + '0';        
+
+  sendRadioPacket[0] = XYZ_TYPE; // packet type
+
+  editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
+
+  editRadioPacket(sendRadioPacket, 5, xyzMessage, 3); // xyz payload
+
+  editRadioPacket(sendRadioPacket, 8, ascXpos, 3);  // x-pos
+  editRadioPacket(sendRadioPacket, 11, ascYpos, 3); // y-pos
+  editRadioPacket(sendRadioPacket, 14, ascZpos, 2); // z-pos
+
+}
+
+/**
+ * @brief Fills a ROT packet - type, sender, "ROT", angle as three
+ * ASCII digits.
+ */
+void s4741858_ascsys_rot_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint8_t angle) {
+
+  uint8_t ascAngle[3] = {0};
+
+  sendRadioPacket[0] = ROT_TYPE;
+  editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
+
+  editRadioPacket(sendRadioPacket, 5, rotMessage, 3); // angle payload
+
+  ascAngle[0] = (angle / 100) % 10 + '0'; // calculate hundreds digit
+  ascAngle[1] = (angle / 10) % 10 + '0';  // calculate tens digit
+  ascAngle[2] = angle % 10 + '0';         // calculate ones digit
+  editRadioPacket(sendRadioPacket, 8, ascAngle, 3); // angle value
+
+}
+
+/**
+ * @brief Fills an execute-at packet - type, sender, "EXEC", controller
+ * tick. Applies to the command packet queued straight after it.
+ */
+void s4741858_ascsys_exec_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint32_t executeTick) {
+
+  sendRadioPacket[0] = EXEC_TYPE;
+  editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
+  editRadioPacket(sendRadioPacket, 5, execMessage, 4); // exec payload
+  s4741858_txradio_put_tick(sendRadioPacket, executeTick); // execute at
+
+}
+
+/**
+ * @brief Enables scheduled commands. Only takes effect once the radio
+ * task has sent the controller clock (JOIN), until then commands are
+ * released by the motion model as before.
+ * @param enable 1 to send ahead with execute-at ticks
+ */
+extern void s4741858_ascsys_schedule(int enable) {
+  scheduleEnabled = enable;
+}
+
+/**
+ * @brief Fills a vacuum packet - type, sender, "VON" or "VOFF".
+ */
+void s4741858_ascsys_vac_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint8_t vacumStatus) {
+
+  sendRadioPacket[0] = VAC_TYPE;
+  editRadioPacket(sendRadioPacket, 1, senderAdress, 4); // sender address
+  if (vacumStatus == 0) {
+    editRadioPacket(sendRadioPacket, 5, VoffMessage, 4); // vacuum off
+  } else {
+    editRadioPacket(sendRadioPacket, 5, VonMessage, 3); // vacuum on
+  }
+
+}
+
 /**
  * @brief This function takes in the radio packet array, the index at which to start editing, the new data to be inserted,
  * and the size of the new data - INTERNAL FUNCTION
@@ -378,5 +1193,16 @@ void editRadioPacket(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], int startI
 
 }
 
-#endif
+/**
+ * @brief Resolves a keypad event to its action table entry. The lowest set
+ * bit wins, found with count trailing zeros (single CLZ/RBIT on cortex-m4).
+ * @param keypadBits non-zero event bits from keypadctrlEventGroup
+ * @return pointer to the constant table entry for that key
+ */
+const ASC_KeyAction *s4741858_ascsys_key_action(EventBits_t keypadBits) {
+
+    return &ascKeyActions[__builtin_ctz(keypadBits & KEYPAD_PRESS_EVENT)];
 
+}
+
+#endif
@@ -26,6 +26,11 @@
 #include "s4741858_oled.h"
 #include "s4741858_txradio.h"
 #include "s4741858_keypad.h"
+#include "s4741858_planner.h"
+#include "s4741858_motion.h"
+#include "s4741858_coord.h"
+#include "s4741858_traj.h"
+#include "s4741858_joystick.h"
 
 #include "debug_log.h"
 
@@ -42,12 +47,16 @@
 #define IDLE_STATE 1
 #define TRANSMITTING_STATE 2
 #define DISPLAYING_STATE 3
+#define PLANNING_STATE 4
+#define MACRO_STATE 5
+#define JOG_STATE 6
 
 
 /* PACKET STARTERS  -----------------------------------------*/
 #define XYZ_TYPE 0x22
 #define ROT_TYPE 0x23
 #define VAC_TYPE 0x24
+#define NO_TYPE  0x00 // controller only key, nothing sent
 
 
 /* EVENT KEYPAD MAPPINGS -----------------------------------------*/
@@ -64,11 +73,140 @@
 #define EVT_KEY_9   1 << 10 // Point [150,150]
 #define EVT_KEY_C   1 << 11 // Point [Rotate +10]
 #define EVT_KEY_0   1 << 12 // Toggle Vacuum
+#define EVT_KEY_D   1 << 13 // Macro record start / stop
+#define EVT_KEY_E   1 << 14 // Macro replay at recorded pace
+#define EVT_KEY_F   1 << 15 // Macro replay fast
 
 #define KEYPAD_PRESS_EVENT    (EVT_KEY_0 | EVT_KEY_1 | EVT_KEY_2 | EVT_KEY_3 \
                              | EVT_KEY_4 | EVT_KEY_5 | EVT_KEY_6 | EVT_KEY_7 \
                              | EVT_KEY_8 | EVT_KEY_9 | EVT_KEY_A | EVT_KEY_B \
-                             | EVT_KEY_C)
+                             | EVT_KEY_C | EVT_KEY_D | EVT_KEY_E | EVT_KEY_F)
+
+/* KEY ACTION TABLE -----------------------------------------*/
+// Operation applied to the gantry state when a key is resolved
+#define ASC_OP_MOVE   0 // absolute XY move to table target
+#define ASC_OP_ZDOWN  1 // lower Z by ASC_Z_STEP
+#define ASC_OP_ZUP    2 // raise Z by ASC_Z_STEP
+#define ASC_OP_ROTATE 3 // rotate by ASC_ANGLE_STEP
+#define ASC_OP_VACUUM 4 // toggle vacuum
+#define ASC_OP_MACRO_REC  5 // macro record start / stop
+#define ASC_OP_MACRO_PLAY 6 // macro replay at recorded pace
+#define ASC_OP_MACRO_FAST 7 // macro replay as fast as link allows
+
+#define ASC_Z_STEP      10
+#define ASC_Z_MAX       90
+#define ASC_ANGLE_STEP  10
+#define ASC_ANGLE_MAX   180
+
+/*
+ * Key layout - one row per event bit, X(bit, x, y, cursorX, cursorY, type, op)
+ * Swap this table to change the grid, dispatch code never changes.
+ * Cursor values only matter for ASC_OP_MOVE rows.
+ */
+#define ASC_KEY_ACTION_TABLE(X) \
+  X(0,  0,   150, 1,  3,  XYZ_TYPE, ASC_OP_MOVE)   /* KEY 1 */ \
+  X(1,  75,  150, 12, 3,  XYZ_TYPE, ASC_OP_MOVE)   /* KEY 2 */ \
+  X(2,  150, 150, 25, 3,  XYZ_TYPE, ASC_OP_MOVE)   /* KEY 3 */ \
+  X(3,  0,   0,   0,  0,  XYZ_TYPE, ASC_OP_ZDOWN)  /* KEY A */ \
+  X(4,  0,   75,  1,  13, XYZ_TYPE, ASC_OP_MOVE)   /* KEY 4 */ \
+  X(5,  75,  75,  13, 13, XYZ_TYPE, ASC_OP_MOVE)   /* KEY 5 */ \
+  X(6,  150, 75,  25, 13, XYZ_TYPE, ASC_OP_MOVE)   /* KEY 6 */ \
+  X(7,  0,   0,   0,  0,  XYZ_TYPE, ASC_OP_ZUP)    /* KEY B */ \
+  X(8,  0,   0,   1,  23, XYZ_TYPE, ASC_OP_MOVE)   /* KEY 7 */ \
+  X(9,  75,  0,   13, 23, XYZ_TYPE, ASC_OP_MOVE)   /* KEY 8 */ \
+  X(10, 150, 0,   25, 23, XYZ_TYPE, ASC_OP_MOVE)   /* KEY 9 */ \
+  X(11, 0,   0,   0,  0,  ROT_TYPE, ASC_OP_ROTATE) /* KEY C */ \
+  X(12, 0,   0,   0,  0,  VAC_TYPE, ASC_OP_VACUUM) /* KEY 0 */ \
+  X(13, 0,   0,   0,  0,  NO_TYPE,  ASC_OP_MACRO_REC)  /* KEY D */ \
+  X(14, 0,   0,   0,  0,  NO_TYPE,  ASC_OP_MACRO_PLAY) /* KEY E */ \
+  X(15, 0,   0,   0,  0,  NO_TYPE,  ASC_OP_MACRO_FAST) /* KEY F */
+
+#define ASC_KEY_COUNT 16
+
+// Single table entry - everything needed to act on one key
+typedef struct {
+    uint8_t x;          // target x position (ASC_OP_MOVE)
+    uint8_t y;          // target y position (ASC_OP_MOVE)
+    uint8_t cursorX;    // OLED marker column
+    uint8_t cursorY;    // OLED marker row
+    uint8_t packetType; // XYZ_TYPE, ROT_TYPE or VAC_TYPE
+    uint8_t op;         // ASC_OP_*
+} ASC_KeyAction;
+
+#define MOTION_PROGRESS_PERIOD 100 // ms between OLED progress updates
+#define ASC_IDLE_WAIT_MS       50  // longest idle wait for keys - a key wakes it at once
+
+// Scheduled commands off by default - needs a gantry that handles EXEC_TYPE
+#define ASC_SCHEDULE_DEFAULT 0
+
+// Interpolated moves on by default - trapezoid waypoints instead of one jump
+#define ASC_TRAJ_DEFAULT 1
+
+/* JOYSTICK JOG -----------------------------------------*/
+#define ASC_XY_MAX         150  // workspace limit both axes
+#define JOG_SAMPLE_PERIOD  20   // ms - 50 Hz axis sampling
+#define JOG_TX_PERIOD      100  // ms - minimum gap between streamed packets
+#define JOG_MIN_DELTA      1    // units - smaller moves are coalesced
+#define JOG_ADC_CENTRE     2048 // 12 bit ADC mid scale
+#define JOG_DEADZONE       150  // ADC counts either side of centre
+#define JOG_MAX_SPEED      100  // units per second at full deflection
+#define JOG_EXIT_MS        300  // centred this long drops back to idle
+
+// OLED marker range for off grid positions (x 0-150, y 150-0)
+#define ASC_CURSOR_X_MIN   1
+#define ASC_CURSOR_X_MAX   25
+#define ASC_CURSOR_Y_MIN   3
+#define ASC_CURSOR_Y_MAX   23
+
+// Gantry state as last commanded by the controller
+typedef struct {
+    ASC_Coord x; // fixed point, whole units on air
+    ASC_Coord y;
+    ASC_Coord z;
+    ASC_Coord angle;
+    uint8_t vacumStatus; // 0x00 off, 0xFF on
+} ASC_GantryState;
+
+extern QueueHandle_t s4741858QueuePlannerJobs; // pick and place job lists
+
+// One job list being worked through, command by command
+typedef struct {
+    const ASC_PlannerJobList *jobList;
+    uint8_t order[PLANNER_MAX_JOBS];
+    uint8_t job;  // position in order
+    uint8_t step; // 0-7, move / z down / vacuum / z up for pick then place
+} ASC_PlanCursor;
+
+/* MACRO RECORD / REPLAY -----------------------------------------*/
+#define MACRO_MAX_COMMANDS 128 // ring buffer length, oldest dropped when full
+
+#define MACRO_REPLAY_OFF  0
+#define MACRO_REPLAY_PACE 1 // recorded delays between commands
+#define MACRO_REPLAY_FAST 2 // back to back, paced by radio queue only
+
+// Requests from other tasks - only the controller touches the ring and
+// flash, it takes the latest request at the top of IDLE_STATE
+#define MACRO_REQUEST_NONE   0
+#define MACRO_REQUEST_RECORD 1 // clear the ring, start recording
+#define MACRO_REQUEST_STOP   2 // stop recording, save to flash
+#define MACRO_REQUEST_PACE   3 // stop recording, replay at recorded pace
+#define MACRO_REQUEST_FAST   4 // stop recording, replay back to back
+
+// Persisted in the last bank 2 sector so erase never stalls bank 1 fetch
+#define MACRO_FLASH_SECTOR  FLASH_SECTOR_23
+#define MACRO_FLASH_ADDRESS 0x081E0000
+#define MACRO_FLASH_MAGIC   0x4D414352 // "MACR"
+
+// One resolved command - full gantry snapshot plus delay since previous
+typedef struct {
+    uint8_t type; // XYZ_TYPE, ROT_TYPE or VAC_TYPE
+    uint8_t x;
+    uint8_t y;
+    uint8_t z;
+    uint8_t angle;
+    uint8_t vacumStatus;
+    uint16_t delayMs;
+} ASC_MacroCommand;
 
 // Define Rest Later
 
@@ -78,3 +216,16 @@ void s4741858_reg_ascsys_hardware_init();
 void s4741858_TaskAscFSMcontroller( void ); // RTOS
 extern void s4741858_tsk_ascsystem_init();
 void editRadioPacket(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], int startIndex, uint8_t *newData, int newDataSize);
+const ASC_KeyAction *s4741858_ascsys_key_action(EventBits_t keypadBits);
+void s4741858_ascsys_xyz_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint8_t x, uint8_t y, uint8_t z);
+void s4741858_ascsys_rot_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint8_t angle);
+void s4741858_ascsys_vac_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint8_t vacumStatus);
+void s4741858_ascsys_exec_packet(uint8_t sendRadioPacket[TASK_RADIO_PACKET_SIZE], uint32_t executeTick);
+extern void s4741858_ascsys_schedule(int enable);
+extern void s4741858_ascsys_jog(int enable);
+extern void s4741858_ascsys_trajectory(int enable);
+extern int s4741858_ascsys_select_target(int target);
+extern void s4741858_ascsys_target_state(int target, ASC_GantryState *state);
+extern int s4741858_ascsys_submit_jobs(const ASC_PlannerJobList *jobList);
+extern void s4741858_ascsys_macro_record(int enable);
+extern void s4741858_ascsys_macro_replay(int mode);
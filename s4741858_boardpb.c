@@ -18,6 +18,8 @@
 #include "board.h"
 #include "processor_hal.h"
 #include "s4741858_boardpb.h"
+#include "s4741858_keypad.h"
+#include "s4741858_debounce.h"
 
 // Static variable which is only accessible by this document.
 static volatile int operatingMode = ENCODE_MODE; 
@@ -39,62 +41,38 @@ void s4741858_reg_board_pb_init() {
 	GPIOC->PUPDR &= ~(0x03 << (13 * 2));			//Clear bits for no push/pull
 	GPIOC->MODER &= ~(0x03 << (13 * 2));			//Clear bits for input mode
 
-    // Enable EXTI clock
-	RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
-
-	//select trigger source (port c, pin 13) on EXTICR4.
-	SYSCFG->EXTICR[3] &= ~SYSCFG_EXTICR4_EXTI13;
-	SYSCFG->EXTICR[3] |= SYSCFG_EXTICR4_EXTI13_PC;
-
-	EXTI->RTSR |= EXTI_RTSR_TR13;	//enable rising dedge
-	EXTI->FTSR &= ~EXTI_FTSR_TR13;	//disable falling edge
-	EXTI->IMR |= EXTI_IMR_IM13;		//Enable external interrupt
-
-	//Enable priority (10) and interrupt callback. Do not set a priority lower than 5.
-	HAL_NVIC_SetPriority(EXTI15_10_IRQn, 10, 0);
-	HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+	// Sampled and debounced every ms - no EXTI, presses arrive clean
+	s4741858_reg_debounce_init(DEBOUNCE_BOARD_PB);
 
 }
 
 /**
- * @brief Interrupt service routine that toggles encode/decode.
+ * @brief Interrupt service routine that toggles encode/decode,
+ * called by the debouncer once per clean press.
  */
 void s4741858_reg_board_pb_isr() {
-	
-	static int ptime = 0;
-	static int pressed = 0;
-
-    // DEBOUNCING and MODE TOGGLE
 
-	if (((HAL_GetTick() - ptime) > 200) && (!pressed)) {
-        
-		pressed = 1;
+    // MODE TOGGLE
+    if(operatingMode == ENCODE_MODE) {
+        operatingMode = DECODE_MODE;
+    } else {
+        operatingMode = ENCODE_MODE;
+    }
 
-        if(operatingMode == ENCODE_MODE) {
-            operatingMode = DECODE_MODE;
-        } else {
-            operatingMode = ENCODE_MODE;
-        }
+	// FreeRTOS Interrupt
+	#ifdef FreeRTOS
 
-		// FreeRTOS Interrupt
-		#ifdef FreeRTOS
+	BaseType_t xHigherPriorityTaskWoken;
+	xHigherPriorityTaskWoken = pdFALSE;
 
-		BaseType_t xHigherPriorityTaskWoken;
-		xHigherPriorityTaskWoken = pdFALSE;
-
-		if (s4741858SemaphorePBSig != NULL) {	// Check if semaphore exists 
-			xSemaphoreGiveFromISR( s4741858SemaphorePBSig, &xHigherPriorityTaskWoken );		// Give PB Semaphore from ISR
-		}
-
-		// Perform context switching, if required.
-		portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
-		
-		#endif
-
-	} else {
-		pressed = 0;
+	if (s4741858SemaphorePBSig != NULL) {	// Check if semaphore exists 
+		xSemaphoreGiveFromISR( s4741858SemaphorePBSig, &xHigherPriorityTaskWoken );		// Give PB Semaphore from ISR
 	}
-	ptime = HAL_GetTick();
+
+	// Perform context switching, if required.
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+	
+	#endif
 }
 
 /**
@@ -114,13 +92,13 @@ void EXTI15_10_IRQHandler(void) {
 
 	NVIC_ClearPendingIRQ(EXTI15_10_IRQn);
 
-	// PR: Pending register
-	if ((EXTI->PR & EXTI_PR_PR13) == EXTI_PR_PR13) {
+	// Keypad rows 3 / 4 (PE15 / PE14) - the board PB is sampled by the
+	// debouncer and no longer raises this vector
+	if ((EXTI->PR & (EXTI_PR_PR14 | EXTI_PR_PR15)) != 0) {
 
-		// cleared by writing a 1 to this bit
-		EXTI->PR |= EXTI_PR_PR13;	//Clear interrupt flag.
+		EXTI->PR = EXTI_PR_PR14 | EXTI_PR_PR15;	//Clear interrupt flag, these bits only.
 
-		s4741858_reg_board_pb_isr();   // ISR function
+		s4741858_reg_keypad_row_isr();
 
 	}
 }
@@ -15,7 +15,10 @@
  */
 
 /* FreeRTOS ------------------- */
+// Off with -DMYLIB_NO_FREERTOS, see s4741858_keypad.h
+#ifndef MYLIB_NO_FREERTOS
 #define FreeRTOS
+#endif
 
 /* Includes ------------------------------------------------------------------*/
 #include "board.h"
@@ -0,0 +1,167 @@
+ /**
+ **************************************************************
+ * @file mylib/s4741858_coord.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Fixed point gantry coordinates - range checked,
+ * saturating axis arithmetic, soft workspace limits and XY
+ * keep-out zones held in a precomputed bitmap. No RTOS or HAL
+ * dependencies.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_coord_init() - full range, table keep-out zones
+ * s4741858_lib_coord_limit() - sets soft limits of one axis
+ * s4741858_lib_coord_keepout() - adds a keep-out rectangle
+ * s4741858_lib_coord_clamp() - saturates a value to its axis
+ * s4741858_lib_coord_add() - saturating add on one axis
+ * s4741858_lib_coord_allowed() - O(1) XY target check
+ * s4741858_lib_coord_step() - saturating XY step, slides along
+ * keep-out edges
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "s4741858_coord.h"
+
+static const uint8_t coordHardMax[COORD_AXES] = {COORD_X_MAX, COORD_Y_MAX, COORD_Z_MAX, COORD_ANGLE_MAX};
+
+#define COORD_KEEPOUT_ADD(x0, y0, x1, y1) s4741858_lib_coord_keepout(ws, x0, y0, x1, y1);
+
+/**
+ * @brief Resets the workspace - soft limits at the hard range and
+ * only the COORD_KEEPOUT_TABLE zones blocked.
+ */
+void s4741858_lib_coord_init(ASC_Workspace *ws) {
+
+	for (int axis = 0; axis < COORD_AXES; axis++) {
+		ws->min[axis] = 0;
+		ws->max[axis] = COORD_FROM_INT(coordHardMax[axis]);
+	}
+
+	for (int row = 0; row < COORD_CELLS; row++) {
+		ws->keepout[row] = 0;
+	}
+
+	COORD_KEEPOUT_TABLE(COORD_KEEPOUT_ADD)
+}
+
+/**
+ * @brief Sets the soft limits of one axis, kept inside the hard range.
+ * @param axis COORD_AXIS_*
+ * @param min, max limits in whole units
+ */
+void s4741858_lib_coord_limit(ASC_Workspace *ws, int axis, uint8_t min, uint8_t max) {
+
+	if ((axis < 0) || (axis >= COORD_AXES) || (min > max)) {
+		return;
+	}
+
+	max = (max > coordHardMax[axis]) ? coordHardMax[axis] : max;
+	min = (min > max) ? max : min;
+
+	ws->min[axis] = COORD_FROM_INT(min);
+	ws->max[axis] = COORD_FROM_INT(max);
+}
+
+/**
+ * @brief Blocks an XY rectangle. Every cell the rectangle touches is
+ * set, so the blocked area is never smaller than asked for.
+ * @param x0, y0, x1, y1 corners in whole units, inclusive
+ */
+void s4741858_lib_coord_keepout(ASC_Workspace *ws, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+
+	uint32_t mask = 0;
+
+	x1 = (x1 > COORD_X_MAX) ? COORD_X_MAX : x1;
+	y1 = (y1 > COORD_Y_MAX) ? COORD_Y_MAX : y1;
+
+	if ((x0 > x1) || (y0 > y1)) {
+		return;
+	}
+
+	for (int col = x0 >> COORD_CELL_SHIFT; col <= (x1 >> COORD_CELL_SHIFT); col++) {
+		mask |= (uint32_t) 1 << col;
+	}
+
+	for (int row = y0 >> COORD_CELL_SHIFT; row <= (y1 >> COORD_CELL_SHIFT); row++) {
+		ws->keepout[row] |= mask;
+	}
+}
+
+/**
+ * @brief Saturates a value to the soft limits of its axis.
+ */
+ASC_Coord s4741858_lib_coord_clamp(const ASC_Workspace *ws, int axis, ASC_Coord value) {
+
+	if (value < ws->min[axis]) {
+		return ws->min[axis];
+	}
+
+	if (value > ws->max[axis]) {
+		return ws->max[axis];
+	}
+
+	return value;
+}
+
+/**
+ * @brief Saturating add - result stays inside the axis soft limits and
+ * the sum can not overflow, delta is bounded by the axis span first.
+ */
+ASC_Coord s4741858_lib_coord_add(const ASC_Workspace *ws, int axis, ASC_Coord value, ASC_Coord delta) {
+
+	ASC_Coord span = ws->max[axis] - ws->min[axis];
+
+	value = s4741858_lib_coord_clamp(ws, axis, value);
+	delta = (delta > span) ? span : ((delta < -span) ? -span : delta);
+
+	return s4741858_lib_coord_clamp(ws, axis, value + delta);
+}
+
+/**
+ * @brief Checks an XY target - inside the soft limits and not in a
+ * keep-out cell. Two compares per axis and one bitmap lookup.
+ * @return 1 if the gantry may go there, 0 if not
+ */
+int s4741858_lib_coord_allowed(const ASC_Workspace *ws, ASC_Coord x, ASC_Coord y) {
+
+	if ((x < ws->min[COORD_AXIS_X]) || (x > ws->max[COORD_AXIS_X]) ||
+			(y < ws->min[COORD_AXIS_Y]) || (y > ws->max[COORD_AXIS_Y])) {
+		return 0;
+	}
+
+	// Cell of the rounded position - the one sent on air
+	return !((ws->keepout[COORD_TO_INT(y) >> COORD_CELL_SHIFT] >> (COORD_TO_INT(x) >> COORD_CELL_SHIFT)) & 1);
+}
+
+/**
+ * @brief Moves an XY position by a delta, saturated at the soft limits.
+ * A step into a keep-out cell keeps whichever single axis is still
+ * allowed, so the gantry slides along the edge rather than sticking.
+ * @return 1 if the position changed, 0 if blocked
+ */
+int s4741858_lib_coord_step(const ASC_Workspace *ws, ASC_Coord *x, ASC_Coord *y, ASC_Coord dx, ASC_Coord dy) {
+
+	ASC_Coord newX = s4741858_lib_coord_add(ws, COORD_AXIS_X, *x, dx);
+	ASC_Coord newY = s4741858_lib_coord_add(ws, COORD_AXIS_Y, *y, dy);
+
+	if (!s4741858_lib_coord_allowed(ws, newX, newY)) {
+		if (s4741858_lib_coord_allowed(ws, newX, *y)) {
+			newY = *y;
+		} else if (s4741858_lib_coord_allowed(ws, *x, newY)) {
+			newX = *x;
+		} else {
+			return 0;
+		}
+	}
+
+	if ((newX == *x) && (newY == *y)) {
+		return 0;
+	}
+
+	*x = newX;
+	*y = newY;
+
+	return 1;
+}
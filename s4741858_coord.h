@@ -0,0 +1,79 @@
+#ifndef COORD_H
+#define COORD_H
+ /**
+ **************************************************************
+ * @file mylib/s4741858_coord.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Fixed point gantry coordinates - range checked,
+ * saturating axis arithmetic, soft workspace limits and XY
+ * keep-out zones held in a precomputed bitmap.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_coord_init() - full range, table keep-out zones
+ * s4741858_lib_coord_limit() - sets soft limits of one axis
+ * s4741858_lib_coord_keepout() - adds a keep-out rectangle
+ * s4741858_lib_coord_clamp() - saturates a value to its axis
+ * s4741858_lib_coord_add() - saturating add on one axis
+ * s4741858_lib_coord_allowed() - O(1) XY target check
+ * s4741858_lib_coord_step() - saturating XY step, slides along
+ * keep-out edges
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Fixed Point -----------------------------------------*/
+// Q24.8 - 1/256 unit resolution, whole units on air
+typedef int32_t ASC_Coord;
+
+#define COORD_FRAC_BITS 8
+#define COORD_ONE       (1 << COORD_FRAC_BITS)
+
+#define COORD_FROM_INT(u) ((ASC_Coord) (u) * COORD_ONE)
+#define COORD_TO_INT(c)   (((c) + (COORD_ONE / 2)) >> COORD_FRAC_BITS) // rounded, c >= 0
+
+/* Axes -----------------------------------------*/
+#define COORD_AXIS_X     0
+#define COORD_AXIS_Y     1
+#define COORD_AXIS_Z     2
+#define COORD_AXIS_ANGLE 3
+#define COORD_AXES       4
+
+// Hard range - what the packet format can carry, soft limits sit inside
+#define COORD_X_MAX      150
+#define COORD_Y_MAX      150
+#define COORD_Z_MAX      99
+#define COORD_ANGLE_MAX  180
+
+/* Keep-out Bitmap -----------------------------------------*/
+// XY split into square cells, one row word per cell row - bit set is blocked
+#define COORD_CELL_SHIFT 3 // 8 unit cells
+#define COORD_CELLS      ((COORD_X_MAX >> COORD_CELL_SHIFT) + 1)
+
+/*
+ * Keep-out zones built into the bitmap at init, X(x0, y0, x1, y1) in
+ * whole units, corners inclusive. Zones are rounded out to whole cells.
+ * ie. X(60, 60, 90, 90) keeps the gantry off the centre of the grid.
+ */
+#define COORD_KEEPOUT_TABLE(X)
+
+// Soft limits and keep-out bitmap
+typedef struct {
+    ASC_Coord min[COORD_AXES];
+    ASC_Coord max[COORD_AXES];
+    uint32_t keepout[COORD_CELLS]; // bit n of row m is cell [n, m]
+} ASC_Workspace;
+
+/* .c File Functions -----------------------------------------*/
+extern void s4741858_lib_coord_init(ASC_Workspace *ws);
+extern void s4741858_lib_coord_limit(ASC_Workspace *ws, int axis, uint8_t min, uint8_t max);
+extern void s4741858_lib_coord_keepout(ASC_Workspace *ws, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+extern ASC_Coord s4741858_lib_coord_clamp(const ASC_Workspace *ws, int axis, ASC_Coord value);
+extern ASC_Coord s4741858_lib_coord_add(const ASC_Workspace *ws, int axis, ASC_Coord value, ASC_Coord delta);
+extern int s4741858_lib_coord_allowed(const ASC_Workspace *ws, ASC_Coord x, ASC_Coord y);
+extern int s4741858_lib_coord_step(const ASC_Workspace *ws, ASC_Coord *x, ASC_Coord *y, ASC_Coord dx, ASC_Coord dy);
+
+#endif
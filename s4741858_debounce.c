@@ -0,0 +1,156 @@
+ /**
+ **************************************************************
+ * @file mylib/s4741858_debounce.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Shared input debouncer - every digital input sampled
+ * into one bit vector each millisecond and debounced in parallel
+ * with vertical counters. Only clean edges are passed on, to the
+ * keypad, board PB and joystick PB drivers.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_reg_debounce_init() - adds inputs, starts the 1 kHz
+ * sample tick on first call
+ * s4741858_reg_debounce_state() - debounced input vector
+ * s4741858_reg_debounce_isr() - 1 kHz sample and debounce
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "s4741858_debounce.h"
+#include "s4741858_keypad.h"
+#include "s4741858_boardpb.h"
+#include "s4741858_joystick.h"
+
+// KEYPAD - sampled here only in the RTOS timer mode. Other builds scan
+// the keypad themselves, or leave it out, and need no keypad symbols
+#if defined(FreeRTOS) && (KEYPAD_MODE == KEYPAD_MODE_TIMER)
+#define DEBOUNCE_KEYPAD_HOOK 1
+#else
+#define DEBOUNCE_KEYPAD_HOOK 0
+#endif
+
+static volatile uint32_t debounceInputs; // DEBOUNCE_* bits being sampled
+static uint32_t debounceState;           // clean vector
+
+// Vertical counters - plane b holds bit b of every input's counter
+static uint32_t debounceCount[DEBOUNCE_COUNTER_BITS];
+
+/**
+ * @brief Adds inputs to the sampled vector. The first call starts TIM3
+ * update interrupts at DEBOUNCE_TIMER_FREQ, later calls only add bits.
+ * Each driver calls this once its pins are configured.
+ * @param inputs DEBOUNCE_* bits
+ */
+void s4741858_reg_debounce_init(uint32_t inputs) {
+
+    uint32_t running;
+    uint32_t primask = __get_PRIMASK();
+
+    // No RTOS critical section - the joystick and PB drivers also build
+    // without FreeRTOS. PRIMASK restored, so callers may already be masked
+    __disable_irq();
+    running = debounceInputs;
+    debounceInputs |= inputs;
+    __set_PRIMASK(primask);
+
+    if (running != 0) {
+        return;
+    }
+
+    // Timer 3 clock enable
+    __TIM3_CLK_ENABLE();
+
+    // APB1 timers run at SystemCoreClock / 2
+    TIM3->PSC = ((SystemCoreClock / 2) / DEBOUNCE_TIMER_COUNTER_FREQ) - 1;
+    TIM3->ARR = (DEBOUNCE_TIMER_COUNTER_FREQ / DEBOUNCE_TIMER_FREQ) - 1;
+
+    TIM3->DIER |= TIM_DIER_UIE; // update interrupt
+    HAL_NVIC_SetPriority(TIM3_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+
+    TIM3->CR1 |= TIM_CR1_CEN; // Enable the counter
+
+}
+
+/**
+ * @brief Debounced inputs, bit set = active.
+ * @return DEBOUNCE_* vector
+ */
+uint32_t s4741858_reg_debounce_state(void) {
+    return debounceState;
+}
+
+/**
+ * @brief 1 kHz tick - samples every input, advances all counters at
+ * once and hands clean edges to their drivers. The counter of an input
+ * clears whenever its sample agrees with the clean state and counts up
+ * while it disagrees - the carry out of the top plane is the edge.
+ */
+void s4741858_reg_debounce_isr(void) {
+
+    uint32_t inputs = debounceInputs;
+    uint32_t sample = 0;
+    uint32_t delta;
+    uint32_t carry;
+    uint32_t pressed;
+    uint32_t released;
+
+    // SAMPLE - one bit per input
+#if DEBOUNCE_KEYPAD_HOOK
+    if (inputs & DEBOUNCE_KEYPAD) {
+        sample |= s4741858_reg_keypad_scan();
+    }
+#endif
+    sample |= ((GPIOC->IDR >> 13) & 0x01) << 16;
+    sample |= ((GPIOA->IDR >> 3) & 0x01) << 17;
+    sample &= inputs;
+
+    // VERTICAL COUNTERS - same few operations for any number of inputs
+    delta = sample ^ debounceState;
+    carry = delta;
+    for (int plane = 0; plane < DEBOUNCE_COUNTER_BITS; plane++) {
+        uint32_t next = debounceCount[plane] & carry;
+
+        debounceCount[plane] = (debounceCount[plane] ^ carry) & delta;
+        carry = next;
+    }
+
+    if (carry == 0) {
+        return;
+    }
+
+    // EDGES - held for 2^DEBOUNCE_COUNTER_BITS samples
+    debounceState ^= carry;
+    pressed = carry & debounceState;
+    released = carry & ~debounceState;
+
+#if DEBOUNCE_KEYPAD_HOOK
+    if (carry & DEBOUNCE_KEYPAD) {
+        s4741858_reg_keypad_edge_isr(pressed & DEBOUNCE_KEYPAD, released & DEBOUNCE_KEYPAD, HAL_GetTick());
+    }
+#endif
+
+    if (pressed & DEBOUNCE_BOARD_PB) {
+        s4741858_reg_board_pb_isr();
+    }
+
+    if (pressed & DEBOUNCE_JOYSTICK_PB) {
+        s4741858_reg_joystick_pb_isr();
+    }
+
+}
+
+/*
+ * Interrupt handler (ISR) for TIM3 - debounce sample tick
+ */
+void TIM3_IRQHandler(void) {
+
+    NVIC_ClearPendingIRQ(TIM3_IRQn);
+
+    if ((TIM3->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+        TIM3->SR &= ~TIM_SR_UIF; // cleared by writing 0
+        s4741858_reg_debounce_isr();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+ /**
+ **************************************************************
+ * @file mylib/s4741858_debounce.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Shared input debouncer - every digital input sampled
+ * into one bit vector each millisecond and debounced in parallel
+ * with vertical counters. Only clean edges are passed on.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_reg_debounce_init() - adds inputs, starts the 1 kHz
+ * sample tick on first call
+ * s4741858_reg_debounce_state() - debounced input vector
+ * s4741858_reg_debounce_isr() - 1 kHz sample and debounce
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "board.h"
+#include "processor_hal.h"
+
+/* Input Vector -----------------------------------------*/
+// Bit set = input active (key held, button pressed)
+#define DEBOUNCE_KEYPAD      0x0000FFFF // bit n is keypad key value n
+#define DEBOUNCE_BOARD_PB    (1 << 16)  // PC13, active high
+#define DEBOUNCE_JOYSTICK_PB (1 << 17)  // PA3, active high (was rising edge EXTI)
+
+/* Sample Tick -----------------------------------------*/
+#define DEBOUNCE_TIMER_COUNTER_FREQ 100000 // TIM3 count frequency
+#define DEBOUNCE_TIMER_FREQ         1000   // samples per second
+
+// Vertical counter depth - an input changes after 2^bits agreeing samples
+#define DEBOUNCE_COUNTER_BITS 4 // 16 ms at 1 kHz
+
+/* .c File Functions -----------------------------------------*/
+extern void s4741858_reg_debounce_init(uint32_t inputs);
+extern uint32_t s4741858_reg_debounce_state(void);
+extern void s4741858_reg_debounce_isr(void);
+
+#endif
@@ -0,0 +1,163 @@
+ /**
+ **************************************************************
+ * @file mylib/s4741858_diag.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief System health figures for the OLED diagnostics view -
+ * keypress to air latency percentiles, radio queue depth,
+ * packets per second and CPU load.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_diag_init() - starts the cycle counter for CPU load
+ * s4741858_diag_latency() - records one keypress to air latency
+ * s4741858_diag_sample() - current figures, rates refreshed once
+ * per DIAG_RATE_PERIOD_MS
+ * s4741858_diag_idle() - idle time, called from the application
+ * idle hook
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "s4741858_diag.h"
+#include "s4741858_txradio.h"
+
+// LATENCY - histogram, percentiles read off the running sum
+static uint16_t diagLatency[DIAG_LATENCY_BUCKETS];
+static uint16_t diagLatencyTotal;
+
+// RATES - recomputed once per window
+static uint32_t diagWindowTick;
+static uint32_t diagWindowCycles;
+static uint32_t diagWindowPackets;
+static int16_t diagPacketRate;
+static int16_t diagCpuLoad = DIAG_UNKNOWN;
+
+#if DIAG_CPU_LOAD
+#if !configUSE_IDLE_HOOK
+#error "DIAG_CPU_LOAD needs configUSE_IDLE_HOOK 1 and vApplicationIdleHook calling s4741858_diag_idle()"
+#endif
+static volatile uint32_t diagIdleCycles; // idle time this window
+static uint32_t diagIdleLast;            // cycle count at the last hook call
+#endif
+
+/**
+ * @brief Starts the DWT cycle counter - CPU load is idle cycles over
+ * elapsed cycles.
+ */
+void s4741858_diag_init(void) {
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    diagWindowTick = HAL_GetTick();
+    diagWindowCycles = DWT->CYCCNT;
+}
+
+/**
+ * @brief Records one keypress to air latency, called by the radio
+ * task once the first packet of a key is sent.
+ * @param ms key edge to end of transmit
+ */
+void s4741858_diag_latency(uint32_t ms) {
+
+    uint32_t bucket = ms / DIAG_LATENCY_BUCKET_MS;
+
+    bucket = (bucket >= DIAG_LATENCY_BUCKETS) ? DIAG_LATENCY_BUCKETS - 1 : bucket;
+
+    taskENTER_CRITICAL();
+    diagLatency[bucket]++;
+    diagLatencyTotal++;
+
+    // AGE - halve everything, keeps the percentiles tracking recent presses
+    if (diagLatencyTotal >= DIAG_LATENCY_WINDOW) {
+        diagLatencyTotal = 0;
+        for (int i = 0; i < DIAG_LATENCY_BUCKETS; i++) {
+            diagLatency[i] >>= 1;
+            diagLatencyTotal += diagLatency[i];
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Fills in every figure. Percentiles are the upper edge of the
+ * bucket they fall in, rates are those of the last full window.
+ */
+void s4741858_diag_sample(Diag_Snapshot *snap) {
+
+    static const uint8_t percent[3] = {50, 90, 99};
+    int16_t *latency[3] = {&snap->latencyP50, &snap->latencyP90, &snap->latencyP99};
+    uint32_t now = HAL_GetTick();
+    uint32_t packets = 0;
+    uint32_t sum = 0;
+    int p = 0;
+
+    // PERCENTILES - one walk for all three
+    taskENTER_CRITICAL();
+    for (p = 0; p < 3; p++) {
+        *latency[p] = DIAG_UNKNOWN;
+    }
+    p = 0;
+    for (int i = 0; (i < DIAG_LATENCY_BUCKETS) && (diagLatencyTotal != 0) && (p < 3); i++) {
+        sum += diagLatency[i];
+        while ((p < 3) && (sum * 100 >= (uint32_t) diagLatencyTotal * percent[p])) {
+            *latency[p++] = (i + 1) * DIAG_LATENCY_BUCKET_MS;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    // RADIO - queued now, sent since the window opened
+    snap->queueDepth = 0;
+    for (int target = 0; target < s4741858_txradio_targets(); target++) {
+        TXRadio_LinkStats stats;
+
+        if (s4741858QueueRadioTXTarget[target] != NULL) {
+            snap->queueDepth += uxQueueMessagesWaiting(s4741858QueueRadioTXTarget[target]);
+        }
+        s4741858_txradio_link_stats(target, &stats);
+        packets += stats.packets;
+    }
+
+    // WINDOW - rates only move once a second, the view stays readable
+    if (now - diagWindowTick >= DIAG_RATE_PERIOD_MS) {
+        uint32_t cycles = DWT->CYCCNT;
+
+        diagPacketRate = ((packets - diagWindowPackets) * 1000) / (now - diagWindowTick);
+
+#if DIAG_CPU_LOAD
+        uint32_t idle = diagIdleCycles;
+        uint32_t elapsed = cycles - diagWindowCycles;
+
+        diagIdleCycles = 0;
+        // No idle time at all means s4741858_diag_idle() is not being called
+        diagCpuLoad = ((idle == 0) || (elapsed == 0)) ? DIAG_UNKNOWN :
+            100 - (int16_t) (((uint64_t) idle * 100) / elapsed);
+#endif
+        diagWindowTick = now;
+        diagWindowCycles = cycles;
+        diagWindowPackets = packets;
+    }
+
+    snap->packetRate = diagPacketRate;
+    snap->cpuLoad = diagCpuLoad;
+}
+
+/**
+ * @brief Accumulates idle time, called on every pass of the FreeRTOS
+ * idle task from main's vApplicationIdleHook(). Back to back calls are
+ * idle time, a long gap means another task ran in between.
+ */
+void s4741858_diag_idle(void) {
+
+#if DIAG_CPU_LOAD
+    uint32_t cycles = DWT->CYCCNT;
+    uint32_t gap = cycles - diagIdleLast;
+
+    if (gap < DIAG_IDLE_GAP) {
+        diagIdleCycles += gap;
+    }
+    diagIdleLast = cycles;
+#endif
+}
@@ -0,0 +1,62 @@
+#ifndef DIAG_H
+#define DIAG_H
+ /**
+ **************************************************************
+ * @file mylib/s4741858_diag.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief System health figures for the OLED diagnostics view -
+ * keypress to air latency percentiles, radio queue depth,
+ * packets per second and CPU load.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_diag_init() - starts the cycle counter for CPU load
+ * s4741858_diag_latency() - records one keypress to air latency
+ * s4741858_diag_sample() - current figures, rates refreshed once
+ * per DIAG_RATE_PERIOD_MS
+ * s4741858_diag_idle() - idle time, called from the application
+ * idle hook
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "board.h"
+#include "processor_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Latency Histogram -----------------------------------------*/
+#define DIAG_LATENCY_BUCKETS   64  // last bucket holds everything slower
+#define DIAG_LATENCY_BUCKET_MS 4   // 0 - 255 ms resolved
+#define DIAG_LATENCY_WINDOW    256 // counts halved here, recent presses weigh most
+
+/* CPU Load -----------------------------------------*/
+// Idle time is measured by s4741858_diag_idle(). The idle hook stays in
+// main - FreeRTOSConfig.h needs configUSE_IDLE_HOOK 1 and main's
+//   void vApplicationIdleHook(void) { s4741858_diag_idle(); }
+// Set 0 to build without it, load then reads as unknown
+#define DIAG_CPU_LOAD       1
+#define DIAG_IDLE_GAP       2000 // cycles - longer between hook calls means preempted
+
+#define DIAG_RATE_PERIOD_MS 1000 // packets/s and CPU load window
+#define DIAG_UNKNOWN        0x7FFF
+
+// One set of figures, all shown together
+typedef struct {
+    int16_t latencyP50; // ms, DIAG_UNKNOWN before the first press
+    int16_t latencyP90;
+    int16_t latencyP99;
+    int16_t queueDepth; // packets waiting over all rigs
+    int16_t packetRate; // packets per second
+    int16_t cpuLoad;    // percent
+} Diag_Snapshot;
+
+/* .c File Functions -----------------------------------------*/
+extern void s4741858_diag_init(void);
+extern void s4741858_diag_latency(uint32_t ms);
+extern void s4741858_diag_sample(Diag_Snapshot *snap);
+extern void s4741858_diag_idle(void);
+
+#endif
@@ -18,8 +18,7 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
-#include "board.h"
-#include "processor_hal.h"
+#include <stdint.h> // no HAL needed - also built into the host gantry emulator
 
 /* .c File Functions -----------------------------------------*/
 extern unsigned char s4741858_lib_hamming_byte_decoder(unsigned char value);
@@ -20,6 +20,7 @@
  */
 
 #include "s4741858_joystick.h"
+#include "s4741858_debounce.h"
 
 //#define FreeRTOS // ENABLES FREERTOS FUNCTIONALITY ----------
 
@@ -146,73 +147,32 @@ void s4741858_reg_joystick_pb_init() {
 	GPIOA->PUPDR &= ~(0x03 << (3 * 2));			//Clear bits for no push/pull
 	GPIOA->MODER &= ~(0x03 << (3 * 2));			//Clear bits for input mode
 
-    // Enable EXTI clock
-	RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
-
-    // INTERRUPT TRIGGER SOURCE (input pin essentially)
-    
-    SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI3;
-	SYSCFG->EXTICR[0] |= SYSCFG_EXTICR1_EXTI3_PA;
-
-    EXTI->RTSR |= EXTI_RTSR_TR3;	//enable rising dedge
-	EXTI->FTSR &= ~EXTI_FTSR_TR3;	//disable falling edge
-	EXTI->IMR |= EXTI_IMR_IM3;		//Enable external interrupt
-
-    HAL_NVIC_SetPriority(EXTI3_IRQn, 10, 0);
-	HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+	// Sampled and debounced every ms - no EXTI, presses arrive clean
+	s4741858_reg_debounce_init(DEBOUNCE_JOYSTICK_PB);
 }
 
 /**
- * @brief Interrupt service routine that increments count when called.
+ * @brief Interrupt service routine that increments count, called by
+ * the debouncer once per clean press.
  */
 void s4741858_reg_joystick_pb_isr() {
-	static int ptime = 0;
-	static int pressed = 0;
-
-	//DEBOUNCING!
-	if (((HAL_GetTick() - ptime) > 100) && (!pressed)) {
-    
-		pressed = 1;
-    	count++;
-    	// increment counter
 
-		// FreeRTOS Functio
-		#ifdef FreeRTOS
+	count++; // increment counter
 
-		BaseType_t xHigherPriorityTaskWoken;
-		xHigherPriorityTaskWoken = pdFALSE;
+	// FreeRTOS Functio
+	#ifdef FreeRTOS
 
-		if (s4741858SemaphoreJoystickSig != NULL) {	// Check if semaphore exists 
-			xSemaphoreGiveFromISR( s4741858SemaphoreJoystickSig, &xHigherPriorityTaskWoken );		// Give PB Semaphore from ISR
-		}
+	BaseType_t xHigherPriorityTaskWoken;
+	xHigherPriorityTaskWoken = pdFALSE;
 
-		// Perform context switching, if required.
-		portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
-		
-		#endif
-
-	} else {
-		pressed = 0;
+	if (s4741858SemaphoreJoystickSig != NULL) {	// Check if semaphore exists 
+		xSemaphoreGiveFromISR( s4741858SemaphoreJoystickSig, &xHigherPriorityTaskWoken );		// Give PB Semaphore from ISR
 	}
-	ptime = HAL_GetTick();
-}
-
-/**
- * @brief Activated from interrupt (joystick press), acts to 
- * implicitly call count isr, deals with register bits.
- */
-void EXTI3_IRQHandler(void) {
-
-	NVIC_ClearPendingIRQ(EXTI3_IRQn);
-
-	// PR: Pending register
-	if ((EXTI->PR & EXTI_PR_PR3) == EXTI_PR_PR3) {
 
-		// cleared by writing a 1 to this bit
-		EXTI->PR |= EXTI_PR_PR3;	//Clear interrupt flag.
-
-		s4741858_reg_joystick_pb_isr();   // Callback for A3
-	}
+	// Perform context switching, if required.
+	portYIELD_FROM_ISR( xHigherPriorityTaskWoken );
+	
+	#endif
 }
 
 /**
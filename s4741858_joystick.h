@@ -59,6 +59,7 @@ extern ADC_ChannelConfTypeDef AdcChanConfigY;
 
 /* .c File Functions -----------------------------------------*/
 extern void s4741858_reg_joystick_pb_init();
+extern void s4741858_reg_joystick_pb_isr();
 extern void s4741858_reg_joystick_init();
 extern int s4741858_reg_joystick_press_get();
 extern int s4741858_reg_joystick_readxy();
@@ -12,17 +12,29 @@
  * PMOK keypad rowscanning, circular FSM
  * s4741858_reg_keypad_read_status() - returns keypad hit status
  * s4741858_reg_keypad_read_key() - get function for key hit
+ * s4741858_reg_keypad_row_isr() - row EXTI callback (EXTI mode)
+ * s4741858_reg_keypad_edge_isr() - debounced key edges (TIMER
+ * mode)
+ * s4741858_reg_keypad_scan() - matrix as a 16 bit key bitmap, one
+ * column read per call
+ * s4741858_reg_keypad_read_keys() - debounced key bitmap
+ * s4741858_reg_keypad_event_get() - pops the oldest key event
+ * s4741858_reg_keypad_event_flush() - discards waiting key events
+ * s4741858_reg_keypad_event_bit() - EVT_KEY_* bit of a key value
  *************************************************************** 
  */
 
 /* INCLUDES ----------------------------------------------------------*/
 #include "s4741858_keypad.h"
+#include "s4741858_debounce.h"
 #include "debug_log.h"
 
 
 #ifdef FreeRTOS
 /* RTOS GLOBAL Structures (defined in .h) ----------------------------*/
 EventGroupHandle_t keypadctrlEventGroup; // event group flags - mapping in .h
+static SemaphoreHandle_t keypadRowSemaphore; // given by row EXTI
+static QueueHandle_t keypadScanQueue; // debounce ISR -> keypad task
 
 #endif
 
@@ -32,6 +44,39 @@ static int KeypadStatus = 0; // if key pressed keypadStatus = 1
 static unsigned char KeypadValue; // hex value 0x00 through 0x0F
 static int debounceCount = 0;
 
+/* MATRIX SCAN VARIABLES ----------------------------*/
+// Key value at [column][row], same layout the row scan FSM decodes
+static const uint8_t keypadKeyMap[KEYPAD_SCAN_COLS][4] = {
+    {0x01, 0x04, 0x07, 0x00},
+    {0x02, 0x05, 0x08, 0x0F},
+    {0x03, 0x06, 0x09, 0x0E},
+    {0x0A, 0x0B, 0x0C, 0x0D},
+};
+// Keys held in a column, indexed by KEYPAD_ROW_INDEX() - built at init
+static uint16_t keypadRowKeys[KEYPAD_SCAN_COLS][16];
+static uint16_t keyState; // debounced, bit per key value
+static uint8_t scanCol;   // column driven since the last scan tick
+static uint16_t scanKeys; // last reading of every column
+
+/* KEY EVENT RING ----------------------------*/
+// Single producer (keypad task), single consumer - no lock, each
+// index is written by one side only. Free running, masked on access.
+static Keypad_Event keypadRing[KEYPAD_RING_SIZE];
+static volatile uint32_t keypadRingHead; // producer
+static volatile uint32_t keypadRingTail; // consumer
+
+// EVT_KEY_* bit of each key value
+static const uint32_t keypadEventBits[16] = {
+    EVT_KEY_0, EVT_KEY_1, EVT_KEY_2, EVT_KEY_3, EVT_KEY_4, EVT_KEY_5, EVT_KEY_6, EVT_KEY_7,
+    EVT_KEY_8, EVT_KEY_9, EVT_KEY_A, EVT_KEY_B, EVT_KEY_C, EVT_KEY_D, EVT_KEY_E, EVT_KEY_F,
+};
+
+static void keypad_send_event(unsigned char keypadValue);
+static void keypad_exti_init(void);
+static void keypad_exti_arm(void);
+static void keypad_lut_init(void);
+static void keypad_ring_send(uint8_t key, uint8_t type, uint32_t tick);
+
 
 /* FreeRTOS CODE-----------------------------------------------------*/
 
@@ -59,9 +104,111 @@ void s4741858TaskKeypadControl( void ) {
 
     // Create event group
     keypadctrlEventGroup = xEventGroupCreate();
-    EventBits_t keypadBits;
 
-    unsigned char keypadValue;
+#if KEYPAD_MODE == KEYPAD_MODE_EXTI
+
+    keypadRowSemaphore = xSemaphoreCreateBinary();
+    keypad_exti_init();
+
+    for(;;) {
+
+        // SLEEP - CPU idle until any row is pulled low
+        xSemaphoreTake(keypadRowSemaphore, portMAX_DELAY);
+        vTaskDelay(KEYPAD_SETTLE_MS);
+
+        // ONE SCAN - a pass over the four columns resolves the key
+        taskENTER_CRITICAL();
+        KeypadFsmCurrentstate = RSCAN1_STATE;
+        for (int col = 0; col < 4; col++) {
+            s4741858_reg_keypad_fsmprocessing();
+        }
+        keypad_writecol(KEYPAD_COLS_ALL);
+        taskEXIT_CRITICAL();
+
+        if (s4741858_reg_keypad_read_status() != 0) {
+            keypad_send_event(s4741858_reg_keypad_read_key());
+        }
+
+        // WAIT FOR RELEASE - one event per press, then re-arm
+        while ((GPIOE->IDR & KEYPAD_ROW_MASK) != KEYPAD_ROW_MASK) {
+            vTaskDelay(KEYPAD_RELEASE_POLL_MS);
+        }
+        keypad_exti_arm();
+    }
+
+#elif KEYPAD_MODE == KEYPAD_MODE_TIMER
+
+    Keypad_Event event;
+    TickType_t wait = portMAX_DELAY;
+    uint16_t held = 0;     // keys down, bit per key value
+    uint16_t longSent = 0; // long press already reported
+    uint32_t downTick[16];
+    uint32_t repeatTick[16]; // next repeat due
+
+    keypadScanQueue = xQueueCreate(KEYPAD_EVENT_QUEUE_LENGTH, sizeof(Keypad_Event));
+    s4741858_reg_debounce_init(DEBOUNCE_KEYPAD); // whole matrix sampled every ms
+
+    for(;;) {
+
+        // Sleeps until the debouncer passes an edge or a held key is due
+        if (xQueueReceive(keypadScanQueue, &event, wait) == pdTRUE) {
+            uint16_t bit = 1 << event.key;
+
+            if (event.type == KEYPAD_EVENT_DOWN) {
+                held |= bit;
+                longSent &= ~bit;
+                downTick[event.key] = event.tick;
+                repeatTick[event.key] = event.tick + KEYPAD_REPEAT_DELAY_MS;
+            } else {
+                held &= ~bit;
+            }
+            keypad_ring_send(event.key, event.type, event.tick);
+        }
+
+        // HELD KEYS - long press once, repeat at a fixed period
+        uint32_t now = HAL_GetTick();
+        uint32_t next = 0xFFFFFFFF; // ms until the nearest one is due
+
+        for (uint8_t key = 0; key < 16; key++) {
+            uint16_t bit = 1 << key;
+
+            if (!(held & bit)) {
+                continue;
+            }
+
+            if (!(longSent & bit)) {
+                uint32_t due = downTick[key] + KEYPAD_LONG_PRESS_MS;
+
+                if ((int32_t) (now - due) >= 0) {
+                    keypad_ring_send(key, KEYPAD_EVENT_LONG, due);
+                    longSent |= bit;
+                } else if (due - now < next) {
+                    next = due - now;
+                }
+            }
+
+            if (KEYPAD_REPEAT_KEYS & bit) {
+                if ((int32_t) (now - repeatTick[key]) >= 0) {
+                    keypad_ring_send(key, KEYPAD_EVENT_REPEAT, repeatTick[key]);
+                    repeatTick[key] += KEYPAD_REPEAT_PERIOD_MS;
+
+                    // late - skip missed repeats rather than burst them
+                    if ((int32_t) (now - repeatTick[key]) >= 0) {
+                        repeatTick[key] = now + KEYPAD_REPEAT_PERIOD_MS;
+                    }
+                }
+                if (repeatTick[key] - now < next) {
+                    next = repeatTick[key] - now;
+                }
+            }
+        }
+
+        wait = (next == 0xFFFFFFFF) ? portMAX_DELAY : pdMS_TO_TICKS(next);
+    }
+
+#else
+
+    unsigned char keypadValue = 0xFF;
 
     // Start cyclic executive
     for(;;) {
@@ -71,8 +218,6 @@ void s4741858TaskKeypadControl( void ) {
         s4741858_reg_keypad_fsmprocessing(); //implement row scan
         taskEXIT_CRITICAL();
 
-        static int ptime = 0;
-
         // debounce count tweaked depending on priority and vTaskDelay
         if ( debounceCount > 2000 && s4741858_reg_keypad_read_status() != 0) {
             // TEST TOGGLE
@@ -81,58 +226,227 @@ void s4741858TaskKeypadControl( void ) {
         }
         
         if (keypadValue != 0xFF) {
+            keypad_send_event(keypadValue);
+            keypadValue = 0xFF;
+        }
+    }
+
+    vTaskDelay(2);
+
+#endif
+
+}
+
+/**
+ * @brief Sets the event bit of a resolved key - INTERNAL
+ * @param keypadValue hex value 0x00 through 0x0F
+ */
+static void keypad_send_event(unsigned char keypadValue) {
+
+    xEventGroupSetBits(keypadctrlEventGroup, keypadEventBits[keypadValue & 0x0F]);
+}
+
+/**
+ * @brief Queues a key event for the consumer and flags it in the
+ * event group. Dropped if the ring is full. - INTERNAL
+ */
+static void keypad_ring_send(uint8_t key, uint8_t type, uint32_t tick) {
+
+    uint32_t head = keypadRingHead;
+    Keypad_Event *slot;
+
+    if (head - keypadRingTail >= KEYPAD_RING_SIZE) {
+        return;
+    }
+
+    slot = &keypadRing[head & (KEYPAD_RING_SIZE - 1)];
+    slot->key = key;
+    slot->type = type;
+    slot->tick = tick;
+
+    __DMB(); // slot written before it is published
+    keypadRingHead = head + 1;
+
+    xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_RING);
+}
+
+/**
+ * @brief Pops the oldest key event - single consumer only.
+ * @return 1 if an event was copied out, 0 if the ring is empty
+ */
+int s4741858_reg_keypad_event_get(Keypad_Event *event) {
+
+    uint32_t tail = keypadRingTail;
+
+    if (tail == keypadRingHead) {
+        return 0;
+    }
+
+    __DMB(); // head read before the slot
+    *event = keypadRing[tail & (KEYPAD_RING_SIZE - 1)];
+    __DMB(); // slot read before it is released
+    keypadRingTail = tail + 1;
+
+    return 1;
+}
+
+/**
+ * @brief Discards every waiting key event - consumer side.
+ */
+void s4741858_reg_keypad_event_flush(void) {
+    keypadRingTail = keypadRingHead;
+}
 
-            switch (keypadValue) {
-                case 0x01:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_1);
-                    break;
-                case 0x02:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_2);
-                    break;
-                case 0x03:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_3);
-                    break;
-                case 0x04:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_4);
-                    break;
-                case 0x05:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_5);
-                    break;
-                case 0x06:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_6);
-                    break;
-                case 0x07:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_7);
-                    break;
-                case 0x08:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_8);
-                    break;
-                case 0x09:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_9);
-                    break;
-                case 0x0A:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_A);
-                    break;
-                case 0x0B:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_B);
-                    break;
-                case 0x0C:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_C);
-                    break;
-                case 0x00:
-                    keypadBits = xEventGroupSetBits(keypadctrlEventGroup, EVT_KEY_0);
-                    break;
-                // FILL OUT REST FOR EXTENSION
+/**
+ * @brief Event group bit of a key, as keypad_send_event() sets it.
+ * @param key hex value 0x00 through 0x0F
+ */
+uint32_t s4741858_reg_keypad_event_bit(uint8_t key) {
+    return keypadEventBits[key & 0x0F];
+}
+
+/**
+ * @brief Routes the four row pins to EXTI, falling edge (rows pulled
+ * up, a pressed key pulls its row to the active column) - INTERNAL
+ */
+static void keypad_exti_init(void) {
+
+    // Enable EXTI clock
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+
+    // select trigger source port E - row 2 PE0, row 1 PE2, row 4 PE14, row 3 PE15
+    SYSCFG->EXTICR[0] &= ~(SYSCFG_EXTICR1_EXTI0 | SYSCFG_EXTICR1_EXTI2);
+    SYSCFG->EXTICR[0] |= (SYSCFG_EXTICR1_EXTI0_PE | SYSCFG_EXTICR1_EXTI2_PE);
+    SYSCFG->EXTICR[3] &= ~(SYSCFG_EXTICR4_EXTI14 | SYSCFG_EXTICR4_EXTI15);
+    SYSCFG->EXTICR[3] |= (SYSCFG_EXTICR4_EXTI14_PE | SYSCFG_EXTICR4_EXTI15_PE);
+
+    EXTI->FTSR |= KEYPAD_ROW_MASK;  //enable falling edge
+    EXTI->RTSR &= ~KEYPAD_ROW_MASK; //disable rising edge
+
+    // PE14 / PE15 share EXTI15_10 with the board PB - dispatched in s4741858_boardpb.c
+    HAL_NVIC_SetPriority(EXTI0_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(EXTI0_IRQn);
+    HAL_NVIC_SetPriority(EXTI2_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(EXTI2_IRQn);
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+    keypad_exti_arm();
+
+}
+
+/**
+ * @brief Drives every column active and unmasks the row interrupts,
+ * clearing any edge latched while they were masked - INTERNAL
+ */
+static void keypad_exti_arm(void) {
+
+    keypad_writecol(KEYPAD_COLS_ALL);
+    EXTI->PR = KEYPAD_ROW_MASK;   // cleared by writing a 1
+    EXTI->IMR |= KEYPAD_ROW_MASK; // Enable external interrupt
+
+}
+
+/**
+ * @brief Row interrupt callback - masks the rows so a bouncing contact
+ * wakes the task once, the task re-arms after the key is released.
+ */
+void s4741858_reg_keypad_row_isr(void) {
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    EXTI->IMR &= ~KEYPAD_ROW_MASK;
+
+    if (keypadRowSemaphore != NULL) {
+        xSemaphoreGiveFromISR(keypadRowSemaphore, &xHigherPriorityTaskWoken);
+    }
+
+    // Perform context switching, if required.
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+}
+
+/**
+ * @brief Builds keypadRowKeys - for each column and each level of the
+ * four row pins, the key bits held. Rows are active low. - INTERNAL
+ */
+static void keypad_lut_init(void) {
+
+    for (int col = 0; col < KEYPAD_SCAN_COLS; col++) {
+        for (int index = 0; index < 16; index++) {
+            // index bit 0 PE0 (row 2), 1 PE2 (row 1), 2 PE14 (row 4), 3 PE15 (row 3)
+            uint8_t rows = (((index & 0x02) == 0) << 0) | (((index & 0x01) == 0) << 1) |
+                    (((index & 0x08) == 0) << 2) | (((index & 0x04) == 0) << 3);
+            uint16_t keys = 0;
+
+            for (int row = 0; row < 4; row++) {
+                if (rows & (1 << row)) {
+                    keys |= 1 << keypadKeyMap[col][row];
+                }
             }
+            keypadRowKeys[col][index] = keys;
+        }
+    }
+}
 
-            keypadValue = 0xFF;
+/**
+ * @brief Clean key edges from the shared debouncer, queued to the
+ * keypad task in key order, releases first.
+ * @param pressed, released bit per key value
+ * @param tick HAL tick the edges were accepted
+ */
+void s4741858_reg_keypad_edge_isr(uint16_t pressed, uint16_t released, uint32_t tick) {
 
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    Keypad_Event event;
+
+    keyState = (keyState | pressed) & ~released;
+
+    event.tick = tick;
+    for (uint8_t key = 0; key < 16; key++) {
+        if (released & (1 << key)) {
+            event.type = KEYPAD_EVENT_UP;
+        } else if (pressed & (1 << key)) {
+            event.type = KEYPAD_EVENT_DOWN;
+        } else {
+            continue;
+        }
+
+        event.key = key;
+        if (keypadScanQueue != NULL) {
+            xQueueSendFromISR(keypadScanQueue, &event, &xHigherPriorityTaskWoken);
         }
     }
 
-    vTaskDelay(2);
+    // Perform context switching, if required.
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 
+}
+
+/*
+ * Interrupt handler (ISR) for EXTI 0 - keypad row 2
+ */
+void EXTI0_IRQHandler(void) {
 
+    NVIC_ClearPendingIRQ(EXTI0_IRQn);
+
+    if ((EXTI->PR & EXTI_PR_PR0) == EXTI_PR_PR0) {
+        EXTI->PR = EXTI_PR_PR0; //Clear interrupt flag, this bit only
+        s4741858_reg_keypad_row_isr();
+    }
+}
+
+/*
+ * Interrupt handler (ISR) for EXTI 2 - keypad row 1
+ */
+void EXTI2_IRQHandler(void) {
+
+    NVIC_ClearPendingIRQ(EXTI2_IRQn);
+
+    if ((EXTI->PR & EXTI_PR_PR2) == EXTI_PR_PR2) {
+        EXTI->PR = EXTI_PR_PR2; //Clear interrupt flag, this bit only
+        s4741858_reg_keypad_row_isr();
+    }
 }
 
 
@@ -282,20 +596,22 @@ unsigned char s4741858_reg_keypad_read_key(void) {
  */
 unsigned char keypad_readrow(void) {
     unsigned char rowMask = 0;
+    uint32_t idr = GPIOE->IDR; // one sample for all rows
+
     //Check Row 1 - PE2 - PROJECT CHANGE!!
-    if ((GPIOE->IDR & (0x0001 << 2)) == 0){
+    if ((idr & (0x0001 << 2)) == 0){
         rowMask = 0x01;
     }
     // Check Row 2 - D34 PE0
-    if ((GPIOE->IDR & (0x0001 << 0)) == 0){
+    if ((idr & (0x0001 << 0)) == 0){
         rowMask = 0x02;
     }
     //Check Row 3 - PE15
-    if ((GPIOE->IDR & (0x0001 << 15)) == 0){
+    if ((idr & (0x0001 << 15)) == 0){
         rowMask = 0x04;
     }
     //Check Row 4 - PE14
-    if ((GPIOE->IDR & (0x0001 << 14)) == 0){
+    if ((idr & (0x0001 << 14)) == 0){
         rowMask = 0x08;
     }
 
@@ -304,42 +620,44 @@ unsigned char keypad_readrow(void) {
 }
 
 /**
- * @brief Writes a given column to high
+ * @brief Writes a given column to high - one BSRR write, active
+ * columns reset and the rest set in the same cycle
  * @param colval mask that sets column
  */
 void keypad_writecol(unsigned char colval) {
-    //check and set column 1 - PE12
-    int col1 = (colval & (1 << 0)) >> 0;
-    if (col1 == 0){
-        GPIOE->ODR |= (0x01 << 12);
-    }
-    else {
-        GPIOE->ODR &= ~(0x01 << 12);
-    }
-    //check and set column 2 - PE10
-    int col2 = (colval & (1 << 1)) >> 1;
-    if (col2 == 0){
-        GPIOE->ODR |= (0x01 << 10);
-    }
-    else {
-        GPIOE->ODR &= ~(0x01 << 10);
-    }
-    //check and set column 3 - PE7
-    int col3 = (colval & (1 << 2)) >> 1;
-    if (col3 == 0){
-        GPIOE->ODR |= (0x01 << 7);
-    }
-    else {
-        GPIOE->ODR &= ~(0x01 << 7);
-    }
-    //check and set column 4 - PE8
-    int col4 = (colval & (1 << 3)) >> 3;
-    if (col4 == 0){
-        GPIOE->ODR |= (0x01 << 8);
-    }
-    else {
-        GPIOE->ODR &= ~(0x01 << 8);
-    }
+    uint32_t active = KEYPAD_COL_PINS_OF(colval);
+
+    GPIOE->BSRR = (active << 16) | (KEYPAD_COL_PINS & ~active);
+}
+
+/**
+ * @brief One matrix scan tick - reads the rows of the column driven on
+ * the previous tick, so the rows have had a whole tick to settle after
+ * the column edge, then drives the next column. Decoded through
+ * keypadRowKeys, every held key reported (n-key rollover), no debounce.
+ * At 1 kHz each key is read every KEYPAD_SCAN_COLS ms, a change needs
+ * several reads in a row to pass the debouncer.
+ * @return bitmap, bit n set if key value n is held - other columns as
+ * last read
+ */
+uint16_t s4741858_reg_keypad_scan(void) {
+
+    uint16_t column = keypadRowKeys[scanCol][0]; // every row low = all its keys
+
+    scanKeys = (scanKeys & ~column) | keypadRowKeys[scanCol][KEYPAD_ROW_INDEX(GPIOE->IDR)];
+
+    scanCol = (scanCol + 1) % KEYPAD_SCAN_COLS;
+    keypad_writecol(1 << scanCol);
+
+    return scanKeys;
+}
+
+/**
+ * @brief Debounced keys from the shared debouncer, every key held at once.
+ * @return bitmap, bit n set if key value n is down
+ */
+uint16_t s4741858_reg_keypad_read_keys(void) {
+    return keyState;
 }
 
 /**
@@ -349,6 +667,7 @@ void keypad_writecol(unsigned char colval) {
 void s4741858_reg_keypad_init() {
 
     KeypadFsmCurrentstate = INIT_STATE;
+    keypad_lut_init();
 
     __GPIOE_CLK_ENABLE();
     // OUTPUT PINS - COLUMNS
@@ -12,6 +12,14 @@
  * PMOK keypad rowscanning, circular FSM
  * s4741858_reg_keypad_read_status() - returns keypad hit status
  * s4741858_reg_keypad_read_key() - get function for key hit
+ * s4741858_reg_keypad_row_isr() - row EXTI callback (EXTI mode)
+ * s4741858_reg_keypad_edge_isr() - debounced key edges (TIMER
+ * mode)
+ * s4741858_reg_keypad_scan() - whole matrix as a 16 bit key bitmap
+ * s4741858_reg_keypad_read_keys() - debounced key bitmap
+ * s4741858_reg_keypad_event_get() - pops the oldest key event
+ * s4741858_reg_keypad_event_flush() - discards waiting key events
+ * s4741858_reg_keypad_event_bit() - EVT_KEY_* bit of a key value
  *************************************************************** 
  */
 
@@ -22,7 +30,11 @@
 #include "processor_hal.h"
 
 
-#define FreeRTOS // ENABLES FREERTOS FUNCTIONALITY ----------
+// ENABLES FREERTOS FUNCTIONALITY - on unless built with -DMYLIB_NO_FREERTOS,
+// a header define would force it on in every file including this one
+#ifndef MYLIB_NO_FREERTOS
+#define FreeRTOS
+#endif
 
 // RTOS
 #ifdef FreeRTOS
@@ -30,6 +42,8 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "event_groups.h"
+#include "semphr.h"
+#include "queue.h"
 
 #endif
 
@@ -46,11 +60,61 @@
 #define KEYPAD_COL3() keypad_writecol(0x04)
 #define KEYPAD_COL4() keypad_writecol(0x08)
 
+// Column mask bit -> pin: col1 PE12, col2 PE10, col3 PE7, col4 PE8
+#define KEYPAD_COL_PINS       ((1 << 12) | (1 << 10) | (1 << 7) | (1 << 8))
+#define KEYPAD_COL_PINS_OF(c) ((((c) & 0x01) << 12) | (((c) & 0x02) << 9) | \
+                               (((c) & 0x04) << 5) | (((c) & 0x08) << 5))
+
+// Row pins PE0, PE2, PE14, PE15 packed into 4 bits from one IDR sample
+#define KEYPAD_ROW_INDEX(idr) ((((idr) >> 0) & 0x01) | (((idr) >> 1) & 0x02) | (((idr) >> 12) & 0x0C))
+
+/* Scan Modes -----------------------------------------*/
+#define KEYPAD_MODE_POLL 0 // row scan FSM spun continuously
+#define KEYPAD_MODE_EXTI 1 // columns held active, task sleeps until a row falls
+#define KEYPAD_MODE_TIMER 2 // matrix sampled at 1 kHz by the shared debouncer
+#define KEYPAD_MODE      KEYPAD_MODE_TIMER
+
+#define KEYPAD_ROW_MASK       ((1 << 2) | (1 << 0) | (1 << 15) | (1 << 14)) // PE2 PE0 PE15 PE14
+#define KEYPAD_COLS_ALL       0x0F // every column driven active
+#define KEYPAD_SETTLE_MS      10   // contact bounce after the first row edge
+#define KEYPAD_RELEASE_POLL_MS 10  // release check while a key is held
+
+// TIMER mode - debounce timing set in s4741858_debounce.h
+#define KEYPAD_SCAN_COLS    4
+#define KEYPAD_EVENT_QUEUE_LENGTH 16
+
+// Key event - key is the hex value 0x00 to 0x0F
+#define KEYPAD_EVENT_DOWN   0
+#define KEYPAD_EVENT_UP     1
+#define KEYPAD_EVENT_REPEAT 2 // held past the repeat delay, KEYPAD_REPEAT_KEYS only
+#define KEYPAD_EVENT_LONG   3 // held KEYPAD_LONG_PRESS_MS, once per press
+
+// Auto-repeat and long press - bit n of the key mask is key value n
+#define KEYPAD_REPEAT_KEYS      ((1 << 0x0A) | (1 << 0x0B) | (1 << 0x0C)) // Z down, Z up, rotate
+#define KEYPAD_REPEAT_DELAY_MS  400 // hold before the first repeat
+#define KEYPAD_REPEAT_PERIOD_MS 100 // between repeats
+#define KEYPAD_LONG_PRESS_MS    1000
+
+#define KEYPAD_RING_SIZE 32 // events, power of 2
+
+typedef struct {
+    uint8_t key;
+    uint8_t type;  // KEYPAD_EVENT_*
+    uint32_t tick; // HAL tick (ms) the edge was accepted or the repeat was due
+} Keypad_Event;
+
 /* .c File Functions -----------------------------------------*/
 extern void s4741858_reg_keypad_init();
+extern void s4741858_reg_keypad_row_isr(void);
+extern void s4741858_reg_keypad_edge_isr(uint16_t pressed, uint16_t released, uint32_t tick);
 extern void s4741858_reg_keypad_fsmprocessing(void);
 extern int s4741858_reg_keypad_read_status(void);
 extern unsigned char s4741858_reg_keypad_read_key(void);
+extern uint16_t s4741858_reg_keypad_scan(void);
+extern uint16_t s4741858_reg_keypad_read_keys(void);
+extern int s4741858_reg_keypad_event_get(Keypad_Event *event);
+extern void s4741858_reg_keypad_event_flush(void);
+extern uint32_t s4741858_reg_keypad_event_bit(uint8_t key);
 unsigned char keypad_readrow(void); 
 void keypad_writecol(unsigned char colval);
 
@@ -80,5 +144,9 @@ void s4741858TaskKeypadControl( void );
 #define EVT_KEY_9   1 << 10 // Point [150,150]
 #define EVT_KEY_C   1 << 11 // Point [Rotate +10]
 #define EVT_KEY_0   1 << 12 // Toggle Vacuum
+#define EVT_KEY_D   1 << 13 // Macro record start / stop
+#define EVT_KEY_E   1 << 14 // Macro replay at recorded pace
+#define EVT_KEY_F   1 << 15 // Macro replay fast
+#define EVT_KEY_RING 1 << 16 // key events waiting in the ring (TIMER mode)
 
                              
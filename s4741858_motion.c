@@ -0,0 +1,129 @@
+ /**
+ **************************************************************
+ * @file mylib/s4741858_motion.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Gantry kinematic model - predicts when each issued
+ * command finishes from configured axis speeds. Axes move at
+ * the same time, so the slowest axis sets the move time.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_motion_init() - resets model to idle at a position
+ * s4741858_lib_motion_issue() - adds a command, returns predicted
+ * finish tick
+ * s4741858_lib_motion_stream() - adds a streamed trajectory
+ * waypoint, no per command overhead
+ * s4741858_lib_motion_release() - ms until the next command should
+ * be sent to land as the current one finishes
+ * s4741858_lib_motion_progress() - 0 to 100 progress of the
+ * command currently executing
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "s4741858_motion.h"
+
+/*
+ * Time in ms for one axis to cover the distance between a and b.
+ */
+static uint32_t motion_axis_ms(uint8_t a, uint8_t b, uint32_t speed) {
+
+	uint32_t delta = (a > b) ? (a - b) : (b - a);
+
+	return (delta * 1000 + speed - 1) / speed; // round up
+}
+
+/**
+ * @brief Resets the model - gantry idle at the given position.
+ */
+void s4741858_lib_motion_init(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z, uint8_t angle) {
+
+	model->x = x;
+	model->y = y;
+	model->z = z;
+	model->angle = angle;
+	model->startTick = now;
+	model->doneTick = now;
+}
+
+/*
+ * Moves the model to a position behind whatever is still executing,
+ * fixedMs added on top of the slowest axis.
+ */
+static uint32_t motion_add(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z, uint8_t angle, uint32_t fixedMs) {
+
+	uint32_t duration = motion_axis_ms(model->x, x, MOTION_X_SPEED);
+	uint32_t axis;
+
+	axis = motion_axis_ms(model->y, y, MOTION_Y_SPEED);
+	duration = (axis > duration) ? axis : duration;
+	axis = motion_axis_ms(model->z, z, MOTION_Z_SPEED);
+	duration = (axis > duration) ? axis : duration;
+	axis = motion_axis_ms(model->angle, angle, MOTION_ROT_SPEED);
+	duration = (axis > duration) ? axis : duration;
+
+	// queue behind a command still executing
+	model->startTick = ((int32_t) (model->doneTick - now) > 0) ? model->doneTick : now;
+	model->doneTick = model->startTick + duration + fixedMs;
+
+	model->x = x;
+	model->y = y;
+	model->z = z;
+	model->angle = angle;
+
+	return model->doneTick;
+}
+
+/**
+ * @brief Adds a command to the model. It starts when the previous
+ * command finishes (or now if the gantry is idle).
+ * @param settleMs extra fixed time, ie. vacuum grip
+ * @return predicted tick the command finishes
+ */
+uint32_t s4741858_lib_motion_issue(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z, uint8_t angle, uint32_t settleMs) {
+
+	return motion_add(model, now, x, y, z, angle, settleMs + MOTION_OVERHEAD_MS);
+}
+
+/**
+ * @brief Adds one waypoint of an interpolated trajectory. The gantry
+ * blends streamed waypoints, so only the axis time counts - the
+ * command overhead is charged once when the trajectory is issued.
+ * @return predicted tick the waypoint is reached
+ */
+uint32_t s4741858_lib_motion_stream(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z) {
+
+	return motion_add(model, now, x, y, z, model->angle, 0);
+}
+
+/**
+ * @brief Time until the next command should be released so that it
+ * lands just as the current one finishes.
+ * @return ms to wait, 0 if it can be sent now
+ */
+uint32_t s4741858_lib_motion_release(const ASC_MotionModel *model, uint32_t now) {
+
+	int32_t wait = (int32_t) (model->doneTick - now) - MOTION_RELEASE_LEAD_MS;
+
+	return (wait > 0) ? (uint32_t) wait : 0;
+}
+
+/**
+ * @brief Predicted progress of the command executing at now.
+ * @return 0 to 100, 100 once the gantry is idle
+ */
+uint8_t s4741858_lib_motion_progress(const ASC_MotionModel *model, uint32_t now) {
+
+	uint32_t total = model->doneTick - model->startTick;
+
+	if ((int32_t) (now - model->doneTick) >= 0 || total == 0) {
+		return 100;
+	}
+
+	if ((int32_t) (now - model->startTick) <= 0) {
+		return 0;
+	}
+
+	return (uint8_t) (((now - model->startTick) * 100) / total);
+}
@@ -0,0 +1,54 @@
+#ifndef MOTION_H
+#define MOTION_H
+ /**
+ **************************************************************
+ * @file mylib/s4741858_motion.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Gantry kinematic model - predicts when each issued
+ * command finishes from configured axis speeds.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_motion_init() - resets model to idle at a position
+ * s4741858_lib_motion_issue() - adds a command, returns predicted
+ * finish tick
+ * s4741858_lib_motion_stream() - adds a streamed trajectory
+ * waypoint, no per command overhead
+ * s4741858_lib_motion_release() - ms until the next command should
+ * be sent to land as the current one finishes
+ * s4741858_lib_motion_progress() - 0 to 100 progress of the
+ * command currently executing
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Axis Configuration ---------------------------------------------------------*/
+#define MOTION_X_SPEED          100 // units per second
+#define MOTION_Y_SPEED          100 // units per second
+#define MOTION_Z_SPEED          50  // units per second
+#define MOTION_ROT_SPEED        90  // degrees per second
+#define MOTION_VAC_SETTLE_MS    300 // vacuum grip / release time
+#define MOTION_OVERHEAD_MS      40  // gantry command processing
+#define MOTION_RELEASE_LEAD_MS  10  // radio latency - release this early
+
+// Predicted gantry motion
+typedef struct {
+    uint8_t x;          // position once current command is done
+    uint8_t y;
+    uint8_t z;
+    uint8_t angle;
+    uint32_t startTick; // predicted start of last issued command
+    uint32_t doneTick;  // predicted finish of last issued command
+} ASC_MotionModel;
+
+/* .c File Functions -----------------------------------------*/
+extern void s4741858_lib_motion_init(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z, uint8_t angle);
+extern uint32_t s4741858_lib_motion_issue(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z, uint8_t angle, uint32_t settleMs);
+extern uint32_t s4741858_lib_motion_stream(ASC_MotionModel *model, uint32_t now, uint8_t x, uint8_t y, uint8_t z);
+extern uint32_t s4741858_lib_motion_release(const ASC_MotionModel *model, uint32_t now);
+extern uint8_t s4741858_lib_motion_progress(const ASC_MotionModel *model, uint32_t now);
+
+#endif
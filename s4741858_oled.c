@@ -17,12 +17,160 @@
 #include "processor_hal.h"
 
 #include "s4741858_oled.h"
+#include "s4741858_joystick.h"
+#include "s4741858_diag.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include <string.h>
+#include <stddef.h>
+
+#if OLED_BUS_TRACE
+#include "debug_log.h"
+#endif
 
 QueueHandle_t s4741858QueueOLEDMessage;
+QueueHandle_t s4741858QueueOLEDLog;
+
+// FRAME BUFFERS - render stage draws the back one, flush stage sends
+// the front one, swapped only while the flush stage is idle
+static uint8_t oledFrames[2][OLED_RAM_PAGES][SSD1306_WIDTH];
+static uint8_t oledBack = 0;
+static uint8_t oledFront = 1;
+
+// DIRTY SPANS - first changed column, min > max = clean
+static uint8_t oledDirtyMin[OLED_RAM_PAGES]; // back buffer, since last swap
+static uint8_t oledDirtyMax[OLED_RAM_PAGES];
+static uint8_t oledFlushMin[OLED_RAM_PAGES]; // front buffer, still to send
+static uint8_t oledFlushMax[OLED_RAM_PAGES];
+
+// START LINE - hardware vertical scroll, frame state like the buffers
+static uint8_t oledStartLine;      // back buffer
+static uint8_t oledFlushStartLine; // front buffer, still to send
+static uint8_t oledSentStartLine;  // on the panel
+
+static SemaphoreHandle_t oledFlushGo;   // front buffer ready to send
+static SemaphoreHandle_t oledFlushIdle; // flush stage finished, swap allowed
+
+// GLYPHS - page aligned column images, LSB at the top
+#define OLED_GLYPH_MINUS 10
+#define OLED_GLYPH_BLANK 11
+
+static const uint8_t oledGlyphs[12][OLED_GLYPH_WIDTH] = {
+    {0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00}, // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00, 0x00}, // 1
+    {0x42, 0x61, 0x51, 0x49, 0x46, 0x00}, // 2
+    {0x21, 0x41, 0x45, 0x4B, 0x31, 0x00}, // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10, 0x00}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39, 0x00}, // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x30, 0x00}, // 6
+    {0x01, 0x71, 0x09, 0x05, 0x03, 0x00}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36, 0x00}, // 8
+    {0x06, 0x49, 0x49, 0x29, 0x1E, 0x00}, // 9
+    {0x08, 0x08, 0x08, 0x08, 0x08, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // blank
+};
+
+// BACKGROUND - everything that never changes, copied in whole by
+// grid init and used to restore whatever the marker covered
+#define OLED_BG_GLYPH(x, a, b, c, d, e) [(x)] = (a), [(x) + 1] = (b), [(x) + 2] = (c), [(x) + 3] = (d), [(x) + 4] = (e)
+
+static const uint8_t oledBackground[OLED_PAGES][SSD1306_WIDTH] = {
+    [0] = { // box top edge and sides, "Z:"
+        [0] = 0xFF, [1 ... OLED_GRID_SIZE - 2] = 0x01, [OLED_GRID_SIZE - 1] = 0xFF,
+        OLED_BG_GLYPH(OLED_LABEL_X, 0x61, 0x51, 0x49, 0x45, 0x43),     // Z
+        OLED_BG_GLYPH(OLED_LABEL_X + 6, 0x00, 0x36, 0x36, 0x00, 0x00), // :
+    },
+    [1] = { // box sides
+        [0] = 0xFF, [OLED_GRID_SIZE - 1] = 0xFF,
+    },
+    [2] = { // box sides, "Angle:"
+        [0] = 0xFF, [OLED_GRID_SIZE - 1] = 0xFF,
+        OLED_BG_GLYPH(OLED_LABEL_X, 0x7E, 0x11, 0x11, 0x11, 0x7E),      // A
+        OLED_BG_GLYPH(OLED_LABEL_X + 6, 0x7C, 0x08, 0x04, 0x04, 0x78),  // n
+        OLED_BG_GLYPH(OLED_LABEL_X + 12, 0x0C, 0x52, 0x52, 0x52, 0x3E), // g
+        OLED_BG_GLYPH(OLED_LABEL_X + 18, 0x00, 0x41, 0x7F, 0x40, 0x00), // l
+        OLED_BG_GLYPH(OLED_LABEL_X + 24, 0x38, 0x54, 0x54, 0x54, 0x18), // e
+        OLED_BG_GLYPH(OLED_LABEL_X + 30, 0x00, 0x36, 0x36, 0x00, 0x00), // :
+    },
+    [3] = { // box bottom edge and sides
+        [0] = 0xFF, [1 ... OLED_GRID_SIZE - 2] = 0x80, [OLED_GRID_SIZE - 1] = 0xFF,
+    },
+};
+
+// MARKER - drawn last, erased before the next
+static const char *const oledMarkerGlyphs[] = {
+    [OLED_MARKER_NONE]  = "",
+    [OLED_MARKER_CROSS] = "+",
+};
+#define OLED_MARKER_COUNT (sizeof(oledMarkerGlyphs) / sizeof(oledMarkerGlyphs[0]))
+
+static uint8_t oledMarker = OLED_MARKER_NONE;
+static int oledMarkerX;
+static int oledMarkerY;
+
+// VIEWS - last ASC state kept while diagnostics are shown
+static uint8_t oledView = OLED_VIEW_ASC;
+static int oledViewPresses;          // joystick press count already acted on
+static OLED_ASCMessage oledLastMessage;
+
+// EVENT LOG - line n lives in page n, oldest at the top of the screen
+static char oledLogLines[OLED_RAM_PAGES][OLED_LOG_CHARS + 1]; // by GDDRAM page
+static uint8_t oledLogTop; // GDDRAM page of the oldest line shown
+
+// PLOT - trail points in box pixels, oldest first
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+static uint8_t oledPlotX[OLED_PLOT_TRAIL + 1];
+static uint8_t oledPlotY[OLED_PLOT_TRAIL + 1];
+static uint8_t oledPlotCount; // points held, segments = count - 1
+
+// DIAGNOSTICS - one snapshot drawn a few fields per frame
+static Diag_Snapshot oledDiag;
+static uint8_t oledDiagField;       // next field to draw
+static uint32_t oledDiagTick;       // last diagnostics frame
+
+static const struct {
+    uint8_t x;
+    uint8_t page;
+    uint8_t offset; // int16_t in Diag_Snapshot
+} oledDiagFields[] = {
+    {OLED_DIAG_COL0, 1, offsetof(Diag_Snapshot, latencyP50)},
+    {OLED_DIAG_COL1, 1, offsetof(Diag_Snapshot, latencyP90)},
+    {OLED_DIAG_COL2, 1, offsetof(Diag_Snapshot, latencyP99)},
+    {OLED_DIAG_COL0, 2, offsetof(Diag_Snapshot, queueDepth)},
+    {OLED_DIAG_COL2, 2, offsetof(Diag_Snapshot, packetRate)},
+    {OLED_DIAG_COL0, 3, offsetof(Diag_Snapshot, cpuLoad)},
+};
+#define OLED_DIAG_FIELDS (sizeof(oledDiagFields) / sizeof(oledDiagFields[0]))
+
+static void oled_byte(int page, int x, uint8_t value);
+static void oled_pixel(int x, int y, SSD1306_COLOR color);
+static void oled_text(int x, int y, const char *str, FontDef font, SSD1306_COLOR color, int opaque);
+static void oled_number(int x, int page, int value);
+static void oled_restore(int x, int y, int width, int height);
+static void oled_render(const OLED_ASCMessage *msg);
+static void oled_view(uint8_t view);
+static void oled_render_diag(void);
+static void oled_log_page(int page);
+static void oled_log_add(const char *text);
+static void oled_plot_line(int n, int spacing, SSD1306_COLOR color);
+static void oled_plot_add(uint8_t x, uint8_t y);
+static void oled_render_plot(const OLED_ASCMessage *msg);
+static void oled_swap(void);
+static void oled_flush(void);
+static void oled_send(uint8_t control, uint8_t *data, uint16_t length);
+
+#if OLED_I2C_DMA
+static SemaphoreHandle_t oledI2CDone; // given when the STOP of a transfer is sent
+static volatile uint8_t oledI2CFailed; // error flagged by the ISRs, polled in the address phase
+
+static void oled_dma_init(void);
+static int oled_i2c_wait(uint32_t flag, uint32_t start);
+static void oled_i2c_abort(void);
+#endif
 
 /* REGULAR FUNCTIONS ---------------------------------------------------------*/
 
@@ -90,75 +238,720 @@ void s4741858_reg_oled_init() {
 
 	  ssd1306_Init();	//Initialise SSD1306 OLED.
 
+	  // Partial flushes address a column / page window
+	  ssd1306_WriteCommand(OLED_CMD_ADDR_MODE);
+	  ssd1306_WriteCommand(OLED_ADDR_HORIZONTAL);
+
+#if OLED_I2C_DMA
+	  oled_dma_init(); // every later transfer streamed by DMA
+#endif
+
 }
 
 
 /**
- * @brief FreeRTOS task to share data via queue
- * 
- * Need to worry about enter critical if priority higher??
+ * @brief Draws the static ASC layout - grid boundary box and labels -
+ * into the back buffer, sent with the next frame. Drawn once, messages
+ * only update the marker and values over it.
  */
 void s4741858_reg_oled_asc_grid_init() {
-  	
-    //Clear Screen
-		
-		ssd1306_Fill(Black);
 
-		//Draw Horizontal lines of boundary box - DEFINE 30
-		for (int i=0; i < 30; i++) {
+    // Whole background in one copy, every column sent on the first flush -
+    // the hidden pages too, the log scrolls them into view
+    memcpy(oledFrames[oledBack], oledBackground, sizeof(oledBackground));
+
+    for (int page = 0; page < OLED_RAM_PAGES; page++) {
+        oledDirtyMin[page] = 0;
+        oledDirtyMax[page] = SSD1306_WIDTH - 1;
+        oledFlushMin[page] = 0xFF;
+        oledFlushMax[page] = 0;
+    }
+
+}
+
+/**
+ * @brief Writes one frame buffer byte - 8 pixel rows of a column. The
+ * column is marked dirty only if the byte actually changes. - INTERNAL
+ */
+static void oled_byte(int page, int x, uint8_t value) {
+
+    uint8_t *cell;
+
+    if ((x < 0) || (x >= SSD1306_WIDTH) || (page < 0) || (page >= OLED_RAM_PAGES)) {
+        return;
+    }
+
+    cell = &oledFrames[oledBack][page][x];
+
+    if (value != *cell) {
+        *cell = value;
+        oledDirtyMin[page] = (x < oledDirtyMin[page]) ? x : oledDirtyMin[page];
+        oledDirtyMax[page] = (x > oledDirtyMax[page]) ? x : oledDirtyMax[page];
+    }
+}
+
+/**
+ * @brief Sets one pixel in the frame buffer, y is a GDDRAM row - rows
+ * past SSD1306_HEIGHT only show once the log scrolls them in. - INTERNAL
+ */
+static void oled_pixel(int x, int y, SSD1306_COLOR color) {
+
+    uint8_t cell;
+
+    if ((x < 0) || (x >= SSD1306_WIDTH) || (y < 0) || (y >= OLED_RAM_PAGES * 8)) {
+        return;
+    }
+
+    cell = oledFrames[oledBack][y >> 3][x];
+    cell = (color == SSD1306_WHITE) ? (cell | (1 << (y & 7))) : (cell & ~(1 << (y & 7)));
+    oled_byte(y >> 3, x, cell);
+}
+
+/**
+ * @brief Draws a string into the frame buffer. Opaque text also clears
+ * the glyph background, so redrawing a field needs no separate erase
+ * and unchanged characters leave nothing dirty. - INTERNAL
+ */
+static void oled_text(int x, int y, const char *str, FontDef font, SSD1306_COLOR color, int opaque) {
+
+    SSD1306_COLOR back = (color == SSD1306_WHITE) ? SSD1306_BLACK : SSD1306_WHITE;
+
+    for (; *str != '\0'; str++, x += font.FontWidth) {
+        if ((*str < 32) || (*str > 126)) {
+            continue;
+        }
 
-			ssd1306_DrawPixel(i, 0, SSD1306_WHITE);					//top line
-			ssd1306_DrawPixel(i, SSD1306_HEIGHT-1, SSD1306_WHITE);	//bottom line
-		}
+        for (int row = 0; row < font.FontHeight; row++) {
+            uint16_t bits = font.data[(*str - 32) * font.FontHeight + row];
 
-		//Draw Vertical lines of boundary box - EDIT
-		for (int i=1; i < 30; i++) {
+            for (int col = 0; col < font.FontWidth; col++) {
+                if ((bits << col) & 0x8000) {
+                    oled_pixel(x + col, y + row, color);
+                } else if (opaque) {
+                    oled_pixel(x + col, y + row, back);
+                }
+            }
+        }
+    }
+}
 
-			ssd1306_DrawPixel(0, i, SSD1306_WHITE);					//left line
-			ssd1306_DrawPixel(30-1, i, SSD1306_WHITE);	//right line
+/**
+ * @brief Draws a value field of OLED_VALUE_CHARS glyphs, left aligned
+ * and blank padded, straight into one page - no formatting or font
+ * lookups. Values that do not fit show as dashes. - INTERNAL
+ */
+static void oled_number(int x, int page, int value) {
 
-		}
+    uint8_t field[OLED_VALUE_CHARS];
+    uint8_t digits[OLED_VALUE_CHARS];
+    int count = 0;
+    int n = 0;
+    unsigned int magnitude;
 
-    //Z Value
-		ssd1306_SetCursor(60,5);
-		ssd1306_WriteString("Z:", Font_6x8, SSD1306_WHITE);
+    if ((value > OLED_VALUE_MAX) || (value < OLED_VALUE_MIN)) {
+        memset(field, OLED_GLYPH_MINUS, sizeof(field));
+    } else {
+        if (value < 0) {
+            field[n++] = OLED_GLYPH_MINUS;
+        }
 
-    //ANGLE
-		ssd1306_SetCursor(60,18);
-		ssd1306_WriteString("Angle:", Font_6x8, SSD1306_WHITE);
+        magnitude = (value < 0) ? -value : value;
+        do {
+            digits[count++] = magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude != 0);
 
-    ssd1306_UpdateScreen();
+        while (count > 0) {
+            field[n++] = digits[--count];
+        }
+        while (n < OLED_VALUE_CHARS) {
+            field[n++] = OLED_GLYPH_BLANK;
+        }
+    }
 
+    for (int i = 0; i < OLED_VALUE_CHARS; i++) {
+        for (int col = 0; col < OLED_GLYPH_WIDTH; col++) {
+            oled_byte(page, x + (i * OLED_GLYPH_WIDTH) + col, oledGlyphs[field[i]][col]);
+        }
+    }
 }
 
+/**
+ * @brief Copies the background back over a pixel rectangle, whole
+ * bytes of every page it touches. - INTERNAL
+ */
+static void oled_restore(int x, int y, int width, int height) {
+
+    for (int page = y >> 3; page <= ((y + height - 1) >> 3); page++) {
+        for (int col = x; col < x + width; col++) {
+            if ((page >= 0) && (page < OLED_PAGES) && (col >= 0) && (col < SSD1306_WIDTH)) {
+                oled_byte(page, col, oledBackground[page][col]);
+            }
+        }
+    }
+}
 
+/**
+ * @brief Renders one ASC message into the back buffer - only the parts
+ * that differ from the frame already there change. - INTERNAL
+ */
+static void oled_render(const OLED_ASCMessage *msg) {
+
+    // MARKER - background restored under the old one
+    // Positioning handled in ASCSYS
+    oled_restore(oledMarkerX, oledMarkerY, strlen(oledMarkerGlyphs[oledMarker]) * Font_6x8.FontWidth, Font_6x8.FontHeight);
+    oledMarker = (msg->marker < OLED_MARKER_COUNT) ? msg->marker : OLED_MARKER_NONE;
+    oledMarkerX = msg->cursorXLocation;
+    oledMarkerY = msg->cursorYLocation;
+    oled_text(oledMarkerX, oledMarkerY, oledMarkerGlyphs[oledMarker], Font_6x8, SSD1306_WHITE, 0);
+
+    // PROJECT ADDITIONS - fixed width, opaque, no erase needed -------------------
+    oled_number(OLED_Z_VALUE_X, OLED_Z_PAGE, msg->z);
+    oled_number(OLED_ANGLE_VALUE_X, OLED_ANGLE_PAGE, msg->angle);
+
+    // PREDICTED MOVE PROGRESS - 2 pixel bar, hidden when idle
+    int filled = (msg->progress < 100) ? (msg->progress * OLED_PROGRESS_WIDTH) / 100 : 0;
+    for (int i = 0; i < OLED_PROGRESS_WIDTH; i++) {
+        oled_pixel(OLED_PROGRESS_X + i, OLED_PROGRESS_Y, (i < filled) ? SSD1306_WHITE : SSD1306_BLACK);
+        oled_pixel(OLED_PROGRESS_X + i, OLED_PROGRESS_Y + 1, (i < filled) ? SSD1306_WHITE : SSD1306_BLACK);
+    }
+}
+
+/**
+ * @brief Switches view - the ASC view is restored from the background
+ * and the last state received, the diagnostics view starts with its
+ * labels and fills in its values over the next frames. - INTERNAL
+ */
+static void oled_view(uint8_t view) {
+
+    oledView = view;
+    oledStartLine = 0; // only the log scrolls
+
+    if (view == OLED_VIEW_ASC) {
+        oled_restore(0, 0, SSD1306_WIDTH, SSD1306_HEIGHT);
+        oledMarker = OLED_MARKER_NONE;
+        oled_render(&oledLastMessage);
+        return;
+    }
+
+    for (int page = 0; page < OLED_PAGES; page++) {
+        for (int x = 0; x < SSD1306_WIDTH; x++) {
+            oled_byte(page, x, 0x00);
+        }
+    }
+
+    if (view == OLED_VIEW_LOG) {
+        for (int line = 0; line < OLED_PAGES; line++) {
+            oled_log_page((oledLogTop + line) & (OLED_RAM_PAGES - 1));
+        }
+        oledStartLine = oledLogTop * 8;
+        return;
+    }
+
+    if (view == OLED_VIEW_PLOT) {
+        for (int page = 0; page < OLED_PAGES; page++) {
+            oled_byte(page, 0, 0xFF);
+            oled_byte(page, OLED_PLOT_SIZE - 1, 0xFF);
+        }
+        for (int x = 1; x < OLED_PLOT_SIZE - 1; x++) {
+            oled_byte(0, x, 0x01);
+            oled_byte(OLED_PAGES - 1, x, 0x80);
+        }
+        oled_text(OLED_PLOT_LABEL_X, 0, "X", Font_6x8, SSD1306_WHITE, 0);
+        oled_text(OLED_PLOT_LABEL_X, 8, "Y", Font_6x8, SSD1306_WHITE, 0);
+        oled_text(OLED_PLOT_LABEL_X, 16, "Z", Font_6x8, SSD1306_WHITE, 0);
+
+        // Whole trail once, oldest first so newer segments land on top
+        for (int n = 0; n + 1 < oledPlotCount; n++) {
+            oled_plot_line(n, ((oledPlotCount - 2 - n) / OLED_PLOT_FADE) + 1, SSD1306_WHITE);
+        }
+        oled_render_plot(&oledLastMessage);
+        return;
+    }
+
+    oled_text(0, 0, "Lat", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(OLED_DIAG_COL0, 0, "p50", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(OLED_DIAG_COL1, 0, "p90", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(OLED_DIAG_COL2, 0, "p99", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(0, 8, "ms", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(0, 16, "Queue", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(OLED_DIAG_COL1, 16, "Pkt/s", Font_6x8, SSD1306_WHITE, 0);
+    oled_text(0, 24, "CPU %", Font_6x8, SSD1306_WHITE, 0);
+
+    oledDiagField = 0;
+}
+
+/**
+ * @brief Draws the next OLED_DIAG_PER_FRAME value fields. A new
+ * snapshot is taken each time the first field comes round, so the
+ * cost of a frame stays the same however many figures there are.
+ * - INTERNAL
+ */
+static void oled_render_diag(void) {
+
+    for (int n = 0; n < OLED_DIAG_PER_FRAME; n++) {
+        if (oledDiagField == 0) {
+            s4741858_diag_sample(&oledDiag);
+        }
+
+        oled_number(oledDiagFields[oledDiagField].x, oledDiagFields[oledDiagField].page,
+            *(const int16_t *) ((const uint8_t *) &oledDiag + oledDiagFields[oledDiagField].offset));
+
+        oledDiagField = (oledDiagField + 1) % OLED_DIAG_FIELDS;
+    }
+}
+
+/**
+ * @brief Draws one log line across its whole page, blank padded so
+ * the previous line is overwritten without an erase. - INTERNAL
+ */
+static void oled_log_page(int page) {
+
+    char line[OLED_LOG_CHARS + 1];
+    int n = strlen(oledLogLines[page]);
+
+    memcpy(line, oledLogLines[page], n);
+    memset(&line[n], ' ', OLED_LOG_CHARS - n);
+    line[OLED_LOG_CHARS] = '\0';
+
+    oled_text(0, page * 8, line, Font_6x8, SSD1306_WHITE, 1);
+}
+
+/**
+ * @brief Adds a line to the log. The lines shown are OLED_PAGES pages
+ * of a ring over all 8 GDDRAM pages - the new line goes in the hidden
+ * page just below the bottom one, then the start line moves down one
+ * page so it scrolls in and the oldest scrolls out. One page of data
+ * and one command, nothing else moves in GDDRAM. The start line wraps
+ * at 64 rows, so a ring of only the visible pages would leave the
+ * newest line off screen. - INTERNAL
+ */
+static void oled_log_add(const char *text) {
+
+    int page = (oledLogTop + OLED_PAGES) & (OLED_RAM_PAGES - 1);
+
+    strncpy(oledLogLines[page], text, OLED_LOG_CHARS);
+    oledLogLines[page][OLED_LOG_CHARS] = '\0';
+    oledLogTop = (oledLogTop + 1) & (OLED_RAM_PAGES - 1);
+
+    if (oledView == OLED_VIEW_LOG) {
+        oled_log_page(page);
+        oledStartLine = oledLogTop * 8;
+    }
+}
+
+/**
+ * @brief Draws trail segment n (point n to n + 1) with Bresenham,
+ * every spacing'th pixel only - sparser is fainter. - INTERNAL
+ */
+static void oled_plot_line(int n, int spacing, SSD1306_COLOR color) {
+
+    int x = oledPlotX[n];
+    int y = oledPlotY[n];
+    int x1 = oledPlotX[n + 1];
+    int y1 = oledPlotY[n + 1];
+    int dx = (x1 > x) ? x1 - x : x - x1;
+    int dy = (y1 > y) ? y - y1 : y1 - y; // negative
+    int sx = (x1 > x) ? 1 : -1;
+    int sy = (y1 > y) ? 1 : -1;
+    int err = dx + dy;
+
+    for (int step = 0; ; step++) {
+        if ((step % spacing) == 0) {
+            oled_pixel(x, y, color);
+        }
+        if ((x == x1) && (y == y1)) {
+            break;
+        }
+
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y += sy;
+        }
+    }
+}
+
+/**
+ * @brief Adds a point to the trail. Ageing only changes the segments
+ * that cross into the next fade step and the one that drops off - they
+ * are erased, then those plus anything they crossed are redrawn. The
+ * rest of the trail is not touched. Drawn only in the plot view, the
+ * trail itself is kept in every view. - INTERNAL
+ */
+static void oled_plot_add(uint8_t x, uint8_t y) {
+
+    int px = 1 + ((x > OLED_PLOT_RANGE ? OLED_PLOT_RANGE : x) * (OLED_PLOT_SIZE - 3)) / OLED_PLOT_RANGE;
+    int py = (OLED_PLOT_SIZE - 2) - ((y > OLED_PLOT_RANGE ? OLED_PLOT_RANGE : y) * (OLED_PLOT_SIZE - 3)) / OLED_PLOT_RANGE;
+    int draw = (oledView == OLED_VIEW_PLOT);
+    int segments = (oledPlotCount > 0) ? oledPlotCount - 1 : 0;
+    uint32_t changed = 0; // bit per segment, indexed after the add
+    int boxMinX = SSD1306_WIDTH, boxMaxX = -1, boxMinY = SSD1306_HEIGHT, boxMaxY = -1;
+
+    if ((oledPlotCount > 0) && (oledPlotX[oledPlotCount - 1] == px) && (oledPlotY[oledPlotCount - 1] == py)) {
+        return; // same pixel, trail unchanged
+    }
+
+    // ERASE - segments whose fade step changes or that fall off the end
+    for (int n = 0; draw && (n < segments); n++) {
+        int age = segments - 1 - n;
+
+        if (((age + 1) % OLED_PLOT_FADE == 0) || (age + 1 >= OLED_PLOT_TRAIL)) {
+            oled_plot_line(n, (age / OLED_PLOT_FADE) + 1, SSD1306_BLACK);
+            changed |= 1 << n;
+
+            boxMinX = MIN(boxMinX, MIN(oledPlotX[n], oledPlotX[n + 1]));
+            boxMaxX = MAX(boxMaxX, MAX(oledPlotX[n], oledPlotX[n + 1]));
+            boxMinY = MIN(boxMinY, MIN(oledPlotY[n], oledPlotY[n + 1]));
+            boxMaxY = MAX(boxMaxY, MAX(oledPlotY[n], oledPlotY[n + 1]));
+        }
+    }
+
+    // APPEND - oldest point shifted out once the trail is full
+    if (oledPlotCount == OLED_PLOT_TRAIL + 1) {
+        memmove(oledPlotX, oledPlotX + 1, OLED_PLOT_TRAIL);
+        memmove(oledPlotY, oledPlotY + 1, OLED_PLOT_TRAIL);
+        oledPlotCount--;
+        changed >>= 1;
+    }
+    oledPlotX[oledPlotCount] = px;
+    oledPlotY[oledPlotCount] = py;
+    oledPlotCount++;
+
+    if (!draw || (oledPlotCount < 2)) {
+        return;
+    }
+    segments = oledPlotCount - 1;
+    changed |= 1 << (segments - 1); // the new segment
+
+    // REDRAW - oldest first, changed ones and any crossing an erased box
+    for (int n = 0; n < segments; n++) {
+        int overlap = (MAX(oledPlotX[n], oledPlotX[n + 1]) >= boxMinX) && (MIN(oledPlotX[n], oledPlotX[n + 1]) <= boxMaxX) &&
+            (MAX(oledPlotY[n], oledPlotY[n + 1]) >= boxMinY) && (MIN(oledPlotY[n], oledPlotY[n + 1]) <= boxMaxY);
+
+        if ((changed & (1 << n)) || overlap) {
+            oled_plot_line(n, ((segments - 1 - n) / OLED_PLOT_FADE) + 1, SSD1306_WHITE);
+        }
+    }
+}
+
+/**
+ * @brief Plot view read out - position values beside the box. - INTERNAL
+ */
+static void oled_render_plot(const OLED_ASCMessage *msg) {
+
+    oled_number(OLED_PLOT_VALUE_X, 0, msg->x);
+    oled_number(OLED_PLOT_VALUE_X, 1, msg->y);
+    oled_number(OLED_PLOT_VALUE_X, 2, msg->z);
+}
+
+/**
+ * @brief Frame boundary - the rendered back buffer becomes the front
+ * buffer with its dirty spans, and the new back buffer starts as a copy
+ * so rendering stays incremental. Flush stage must be idle. - INTERNAL
+ */
+static void oled_swap(void) {
+
+    oledFront = oledBack;
+    oledBack ^= 1;
+    memcpy(oledFrames[oledBack], oledFrames[oledFront], sizeof(oledFrames[0]));
+    oledFlushStartLine = oledStartLine;
+
+    for (int page = 0; page < OLED_RAM_PAGES; page++) {
+        oledFlushMin[page] = oledDirtyMin[page];
+        oledFlushMax[page] = oledDirtyMax[page];
+        oledDirtyMin[page] = 0xFF;
+        oledDirtyMax[page] = 0;
+    }
+}
+
+/**
+ * @brief Sends the changed span of each dirty page of the front buffer -
+ * column and page address window set to the span, then only its bytes. - INTERNAL
+ */
+static void oled_flush(void) {
+
+    static uint8_t window[6];
+
+    for (int page = 0; page < OLED_RAM_PAGES; page++) {
+        if (oledFlushMin[page] > oledFlushMax[page]) {
+            continue;
+        }
+
+        window[0] = OLED_CMD_COLUMN_ADDR;
+        window[1] = oledFlushMin[page];
+        window[2] = oledFlushMax[page];
+        window[3] = OLED_CMD_PAGE_ADDR;
+        window[4] = page;
+        window[5] = page;
+        oled_send(OLED_CONTROL_CMD, window, sizeof(window));
+        oled_send(OLED_CONTROL_DATA, &oledFrames[oledFront][page][oledFlushMin[page]], oledFlushMax[page] - oledFlushMin[page] + 1);
+
+        oledFlushMin[page] = 0xFF;
+        oledFlushMax[page] = 0;
+    }
+
+    // SCROLL - after the data, so a new log line is never shown early
+    if (oledFlushStartLine != oledSentStartLine) {
+        window[0] = OLED_CMD_START_LINE | oledFlushStartLine;
+        oled_send(OLED_CONTROL_CMD, window, 1);
+        oledSentStartLine = oledFlushStartLine;
+    }
+
+#if OLED_BUS_TRACE
+    debug_log("F\r\n"); // end of update
+#endif
+}
+
+/**
+ * @brief Sends one command or data stream to the SSD1306. With
+ * OLED_I2C_DMA the bytes are streamed by DMA and the task blocks on
+ * the completion semaphore, so lower priority tasks keep running. - INTERNAL
+ * @param control OLED_CONTROL_CMD or OLED_CONTROL_DATA
+ */
+static void oled_send(uint8_t control, uint8_t *data, uint16_t length) {
+
+#if OLED_BUS_TRACE
+    debug_log("%c", (control == OLED_CONTROL_DATA) ? 'D' : 'C');
+    for (int i = 0; i < length; i++) {
+        debug_log(" %02X", data[i]);
+    }
+    debug_log("\r\n");
+#endif
+
+#if OLED_I2C_DMA
+    uint32_t start = HAL_GetTick();
+
+    oledI2CFailed = 0; // bus errors from here on end the transfer
+    xSemaphoreTake(oledI2CDone, 0); // drop a stale completion
+
+    // ADDRESS PHASE - polled, a few byte times at most
+    if (!oled_i2c_wait(0, start)) {
+        oled_i2c_abort();
+        return;
+    }
+    I2C_DEV->CR1 |= I2C_CR1_START;
+    if (!oled_i2c_wait(I2C_SR1_SB, start)) {
+        oled_i2c_abort();
+        return;
+    }
+    I2C_DEV->DR = OLED_I2C_ADDR;
+    if (!oled_i2c_wait(I2C_SR1_ADDR, start)) {
+        oled_i2c_abort();
+        return;
+    }
+    (void) I2C_DEV->SR2; // SR1 then SR2 read clears ADDR
+    I2C_DEV->DR = control;
+
+    // DATA PHASE - DMA feeds DR on every TXE
+    DMA1->HIFCR = OLED_DMA_CLEAR;
+    OLED_DMA_STREAM->M0AR = (uint32_t) data;
+    OLED_DMA_STREAM->NDTR = length;
+    OLED_DMA_STREAM->CR |= DMA_SxCR_EN;
+    I2C_DEV->CR2 |= I2C_CR2_DMAEN;
+
+    if ((xSemaphoreTake(oledI2CDone, pdMS_TO_TICKS(OLED_I2C_TIMEOUT_MS)) != pdTRUE) || oledI2CFailed) {
+        oled_i2c_abort();
+    }
+#else
+    if (control == OLED_CONTROL_CMD) {
+        for (int i = 0; i < length; i++) {
+            ssd1306_WriteCommand(data[i]);
+        }
+    } else {
+        ssd1306_WriteData(data, length);
+    }
+#endif
+}
+
+#if OLED_I2C_DMA
+/**
+ * @brief DMA1 stream 6 as I2C1 TX - byte wide, memory increment,
+ * direct mode, transfer complete and error interrupts. - INTERNAL
+ */
+static void oled_dma_init(void) {
+
+    __DMA1_CLK_ENABLE();
+
+    OLED_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    while ((OLED_DMA_STREAM->CR & DMA_SxCR_EN) != 0);
+
+    OLED_DMA_STREAM->PAR = (uint32_t) &I2C_DEV->DR;
+    OLED_DMA_STREAM->CR = OLED_DMA_CHANNEL | DMA_SxCR_DIR_0 | DMA_SxCR_MINC | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    OLED_DMA_STREAM->FCR = 0; // direct mode, no FIFO
+
+    oledI2CDone = xSemaphoreCreateBinary();
+
+    HAL_NVIC_SetPriority(OLED_DMA_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(OLED_DMA_IRQn);
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+
+    // NACK, bus error, arbitration lost - I2C1_ER_IRQHandler
+    I2C_DEV->CR2 |= I2C_CR2_ITERREN;
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, 10, 0);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+}
+
+/**
+ * @brief Polls for an SR1 flag, or for the bus to go idle if flag is 0.
+ * @return 1 if seen, 0 on NACK, bus error or OLED_I2C_TIMEOUT_MS - INTERNAL
+ */
+static int oled_i2c_wait(uint32_t flag, uint32_t start) {
+
+    for (;;) {
+        if ((flag == 0) ? ((I2C_DEV->SR2 & I2C_SR2_BUSY) == 0) : ((I2C_DEV->SR1 & flag) != 0)) {
+            return 1;
+        }
+        if (oledI2CFailed || ((I2C_DEV->SR1 & I2C_SR1_AF) != 0) || (HAL_GetTick() - start > OLED_I2C_TIMEOUT_MS)) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Stops the stream and releases the bus after a NACK, DMA error
+ * or timeout. The frame is left dirty on screen until the next change. - INTERNAL
+ */
+static void oled_i2c_abort(void) {
+
+    OLED_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    I2C_DEV->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_ITEVTEN);
+    I2C_DEV->SR1 &= ~(I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO);
+    I2C_DEV->CR1 |= I2C_CR1_STOP;
+    DMA1->HIFCR = OLED_DMA_CLEAR;
+}
+
+/*
+ * Interrupt handler (ISR) for DMA1 stream 6 - OLED stream sent to DR
+ */
+void DMA1_Stream6_IRQHandler(void) {
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    NVIC_ClearPendingIRQ(OLED_DMA_IRQn);
+
+    if ((DMA1->HISR & OLED_DMA_TC_FLAG) != 0) {
+        DMA1->HIFCR = DMA_HIFCR_CTCIF6;
+
+        // Last byte still shifting out - STOP sent on BTF
+        I2C_DEV->CR2 &= ~I2C_CR2_DMAEN;
+        I2C_DEV->CR2 |= I2C_CR2_ITEVTEN;
+    }
+
+    if ((DMA1->HISR & OLED_DMA_TE_FLAG) != 0) {
+        DMA1->HIFCR = DMA_HIFCR_CTEIF6;
+        oledI2CFailed = 1;
+        xSemaphoreGiveFromISR(oledI2CDone, &xHigherPriorityTaskWoken);
+    }
+
+    // Perform context switching, if required.
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/*
+ * Interrupt handler (ISR) for I2C1 events - end of an OLED transfer
+ */
+void I2C1_EV_IRQHandler(void) {
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if ((I2C_DEV->SR1 & I2C_SR1_BTF) != 0) {
+        I2C_DEV->CR1 |= I2C_CR1_STOP;
+        I2C_DEV->CR2 &= ~I2C_CR2_ITEVTEN;
+
+        // COMPLETION - OLED task may start the next span
+        if (oledI2CDone != NULL) {
+            xSemaphoreGiveFromISR(oledI2CDone, &xHigherPriorityTaskWoken);
+        }
+    }
+
+    // Perform context switching, if required.
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/*
+ * Interrupt handler (ISR) for I2C1 errors - NACK, bus error or lost
+ * arbitration ends the OLED transfer as failed
+ */
+void I2C1_ER_IRQHandler(void) {
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    // Release the bus, the stream would otherwise stall on TXE
+    OLED_DMA_STREAM->CR &= ~DMA_SxCR_EN;
+    I2C_DEV->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_ITEVTEN);
+    I2C_DEV->CR1 |= I2C_CR1_STOP;
+    I2C_DEV->SR1 &= ~(I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO);
+
+    // FAILURE - OLED task aborts and leaves the frame dirty
+    oledI2CFailed = 1;
+    if (oledI2CDone != NULL) {
+        xSemaphoreGiveFromISR(oledI2CDone, &xHigherPriorityTaskWoken);
+    }
+
+    // Perform context switching, if required.
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+#endif
 
 /* FreeRTOS Functions-----------------------------------------*/
 
 /**
  * @brief FreeRTOS init function - creates task (call in main)
  * 
- * PRIORITY - is given highest overall priority because it is an
- * overall low latency function and it stops context switching during
- * task (equivalent to enter critical)
+ * PRIORITY - low, spans are streamed by DMA and the task sleeps on
+ * the completion semaphore, so keypad and radio are never held off
  */
 extern void s4741858_tsk_oled_init() {
 
-	// Start the joystick control task
+	// Flush stage hand over - idle to begin with
+	oledFlushGo = xSemaphoreCreateBinary();
+	oledFlushIdle = xSemaphoreCreateBinary();
+	xSemaphoreGive(oledFlushIdle);
+
+	// Start the render and flush stage tasks
   	xTaskCreate( (void *) &s4741858TaskOLEDControl, (const signed char *) "T_OLED", OLEDTASK_STACK_SIZE, NULL, OLEDTASK_PRIORITY, NULL );
+  	xTaskCreate( (void *) &s4741858TaskOLEDFlush, (const signed char *) "T_OLEDF", OLEDFLUSHTASK_STACK_SIZE, NULL, OLEDTASK_PRIORITY, NULL );
+
+}
+
+/**
+ * @brief Adds a line to the OLED event log, from any task. The text
+ * is copied, longer lines are cut at OLED_LOG_CHARS. Never blocks -
+ * the line is dropped if the log queue is full.
+ */
+extern void s4741858_oled_log(const char *text) {
+
+  OLED_LogLine line;
+
+  if (s4741858QueueOLEDLog == NULL) {
+    return;
+  }
+
+  strncpy(line.text, text, OLED_LOG_CHARS);
+  line.text[OLED_LOG_CHARS] = '\0';
+  xQueueSend(s4741858QueueOLEDLog, &line, 0);
 
 }
 
 /**
  * @brief FreeRTOS task that receives message of certain type, ie.
- * can be struct or string or int - through the s4741858QueueOLEDMessage 
- *
+ * can be struct or string or int - through the s4741858QueueOLEDMessage.
+ * RENDER STAGE - draws the latest message into the back buffer and
+ * hands it to the flush stage at the next frame boundary.
  */
 void s4741858TaskOLEDControl( void ) {
   
 
   //OLED_Message RecvMessage;
   OLED_ASCMessage RecvMessage;
+  int framePending = 0; // back buffer rendered, not yet swapped
 
   taskENTER_CRITICAL();	//Stop any interruption of the critical section
   // Init the relevant hardware - ssd OLED
@@ -166,44 +959,86 @@ void s4741858TaskOLEDControl( void ) {
 
   taskEXIT_CRITICAL();
 
-	// Create queue - DEPENDING ON RecvMessage
-  s4741858QueueOLEDMessage = xQueueCreate(10, sizeof(RecvMessage));	
+  s4741858_reg_oled_asc_grid_init(); // static layout, first frame
+  framePending = 1;
+
+  s4741858_diag_init();
+
+  // View toggle - the joystick task is not run, its button is set up here
+  s4741858_reg_joystick_pb_init();
+  oledViewPresses = s4741858_reg_joystick_press_get();
+
+	// Create mailbox - one message deep, senders overwrite it
+  s4741858QueueOLEDMessage = xQueueCreate(1, sizeof(RecvMessage));	
+  s4741858QueueOLEDLog = xQueueCreate(OLED_LOG_QUEUE_LENGTH, sizeof(OLED_LogLine));
 
   
 	for (;;) {
 
+    // VIEW TOGGLE - joystick button, any number of presses since last pass
+    if (s4741858_reg_joystick_press_get() != oledViewPresses) {
+      oledViewPresses = s4741858_reg_joystick_press_get();
+      oled_view((oledView + 1) % OLED_VIEWS);
+      oledDiagTick = HAL_GetTick();
+      framePending = 1;
+    }
+
     // STAGE 4 CODE
     if (s4741858QueueOLEDMessage != NULL) {
 
-      // Check for item received - block atmost for 10 ticks
-			if (xQueueReceive(s4741858QueueOLEDMessage, &RecvMessage, 10 )) {
-        
-        s4741858_reg_oled_asc_grid_init();
+      // Check for item received - mailbox holds only the newest state, short wait while a frame waits for the flush
+			if (xQueueReceive(s4741858QueueOLEDMessage, &RecvMessage, framePending ? OLED_SWAP_POLL : 10 )) {
 
-        // Draw the string - based on position (SCALED) and string value
-        // Positioning handled in ASCSYS       
-        ssd1306_SetCursor(RecvMessage.cursorXLocation, RecvMessage.cursorYLocation); // dx and PF - Y POSITION
-        ssd1306_WriteString(RecvMessage.string, Font_6x8, SSD1306_WHITE);
-
-        // PROJECT ADDITIONS -------------------
-        ssd1306_SetCursor(80, 5);
-        char zPos[4];
-        sprintf(zPos, "%d", RecvMessage.z); 
-        ssd1306_WriteString(zPos, Font_6x8, SSD1306_WHITE); // EDIT
+        oledLastMessage = RecvMessage; // drawn when the ASC view returns
+        oled_plot_add(RecvMessage.x, RecvMessage.y);
+        if (oledView == OLED_VIEW_ASC) {
+          oled_render(&RecvMessage);
+          framePending = 1;
+        } else if (oledView == OLED_VIEW_PLOT) {
+          oled_render_plot(&RecvMessage);
+          framePending = 1;
+        }
+	    }
+    }
 
-        ssd1306_SetCursor(100, 18); 
-        char angle[4];
-        sprintf(angle, "%d", RecvMessage.angle); 
-        ssd1306_WriteString(angle, Font_6x8, SSD1306_WHITE); // EDIT
+    // EVENT LOG - kept in every view, drawn only in the log view
+    if (s4741858QueueOLEDLog != NULL) {
+      OLED_LogLine logLine;
 
-        ssd1306_UpdateScreen();
+      while (xQueueReceive(s4741858QueueOLEDLog, &logLine, 0) == pdTRUE) {
+        oled_log_add(logLine.text);
+        framePending |= (oledView == OLED_VIEW_LOG);
+      }
+    }
 
-	    }
-      
+    // DIAGNOSTICS - fixed number of fields per frame, never more often than the period
+    if ((oledView == OLED_VIEW_DIAG) && !framePending && (HAL_GetTick() - oledDiagTick >= OLED_DIAG_PERIOD_MS)) {
+      oledDiagTick = HAL_GetTick();
+      oled_render_diag();
+      framePending = 1;
     }
 
-    vTaskDelay(2);
+    // FRAME BOUNDARY - swap only when the last frame has been sent
+    if (framePending && (xSemaphoreTake(oledFlushIdle, 0) == pdTRUE)) {
+      oled_swap();
+      framePending = 0;
+      xSemaphoreGive(oledFlushGo);
+    }
 
   }
 }
 
+/**
+ * @brief FLUSH STAGE - sends the front buffer's dirty spans, then
+ * marks itself idle so the render stage may swap again.
+ */
+void s4741858TaskOLEDFlush( void ) {
+
+  for (;;) {
+
+    if (xSemaphoreTake(oledFlushGo, portMAX_DELAY) == pdTRUE) {
+      oled_flush();
+      xSemaphoreGive(oledFlushIdle);
+    }
+  }
+}
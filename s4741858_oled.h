@@ -26,6 +26,7 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
+#include "semphr.h"
 
 /* i2c Defines ---------------------------------------------------------*/
 #define I2C_DEV_SDA_PIN		9
@@ -35,11 +36,91 @@
 #define I2C_DEV_GPIO_CLK()	__GPIOB_CLK_ENABLE()
 
 #define I2C_DEV				I2C1
+
+#define OLED_I2C_FAST_MODE  1 // 1 - 400 kHz fast mode, 0 - 100 kHz standard
+#if OLED_I2C_FAST_MODE
+#define I2C_DEV_CLOCKSPEED 	400000
+#else
 #define I2C_DEV_CLOCKSPEED 	100000
+#endif
+
+/* i2c DMA Transport ---------------------------------------------------------*/
+#define OLED_I2C_DMA        1 // 1 - DMA streams each span, 0 - ssd1306 library writes
+#define OLED_I2C_ADDR       0x78 // SSD1306 0x3C, write
+#define OLED_I2C_TIMEOUT_MS 20   // longest transfer is one 128 byte page
+
+#define OLED_BUS_TRACE      0 // 1 - every transfer logged for replay in host/ssd1306_sim
+
+#define OLED_CONTROL_CMD    0x00 // control byte - command stream follows
+#define OLED_CONTROL_DATA   0x40 // control byte - GDDRAM data follows
+
+// I2C1_TX is DMA1 stream 6, channel 1
+#define OLED_DMA_STREAM     DMA1_Stream6
+#define OLED_DMA_CHANNEL    DMA_SxCR_CHSEL_0
+#define OLED_DMA_IRQn       DMA1_Stream6_IRQn
+#define OLED_DMA_TC_FLAG    DMA_HISR_TCIF6
+#define OLED_DMA_TE_FLAG    DMA_HISR_TEIF6
+#define OLED_DMA_CLEAR      (DMA_HIFCR_CTCIF6 | DMA_HIFCR_CHTIF6 | DMA_HIFCR_CTEIF6 | DMA_HIFCR_CDMEIF6 | DMA_HIFCR_CFEIF6)
+
+/* Display Layout ---------------------------------------------------------*/
+#define OLED_GRID_SIZE      30 // boundary box, top left corner
+#define OLED_LABEL_X        60 // "Z:" / "Angle:", part of the background image
+#define OLED_Z_PAGE         0  // text rows are page aligned, one byte per glyph column
+#define OLED_Z_VALUE_X      80
+#define OLED_ANGLE_PAGE     2
+#define OLED_ANGLE_VALUE_X  100
+#define OLED_VALUE_CHARS    3  // value fields drawn opaque at this width
+#define OLED_VALUE_MAX      999 // out of range values shown as dashes
+#define OLED_VALUE_MIN      -99
+#define OLED_GLYPH_WIDTH    6  // 5x7 glyph and a blank column
+#define OLED_PROGRESS_X     60 // progress bar under Z / Angle text
+#define OLED_PROGRESS_Y     29
+#define OLED_PROGRESS_WIDTH 64
+
+/* Diagnostics View ---------------------------------------------------------*/
+// Joystick button steps ASC view -> system health -> event log -> plot
+#define OLED_VIEW_ASC       0
+#define OLED_VIEW_DIAG      1
+#define OLED_VIEW_LOG       2
+#define OLED_VIEW_PLOT      3
+#define OLED_VIEWS          4
+
+#define OLED_DIAG_PERIOD_MS 100 // between diagnostics frames
+#define OLED_DIAG_PER_FRAME 2   // value fields redrawn per frame, the rest wait their turn
+#define OLED_DIAG_COL0      36  // value columns, labels in front / above
+#define OLED_DIAG_COL1      66
+#define OLED_DIAG_COL2      96
+
+/* Event Log View ---------------------------------------------------------*/
+// One line per page, scrolled by the display start line register
+#define OLED_LOG_CHARS      (SSD1306_WIDTH / 6) // Font_6x8 characters per line
+#define OLED_LOG_QUEUE_LENGTH 8 // lines waiting for the OLED task, extra dropped
+
+/* Trajectory Plot View ---------------------------------------------------------*/
+#define OLED_PLOT_SIZE      32  // square box at the left edge, full height
+#define OLED_PLOT_RANGE     150 // workspace units across the box - ASC_XY_MAX
+#define OLED_PLOT_TRAIL     16  // path segments kept
+#define OLED_PLOT_FADE      4   // segments per fade step, each step drawn sparser
+#define OLED_PLOT_LABEL_X   40  // X / Y / Z read out beside the box
+#define OLED_PLOT_VALUE_X   52
+
+/* Frame Buffer ---------------------------------------------------------*/
+// SSD1306 page = 8 pixel rows, one byte per column, LSB at the top
+#define OLED_PAGES          (SSD1306_HEIGHT / 8)
+#define OLED_RAM_PAGES      8 // GDDRAM is 128 x 64 whatever the panel height, the log scrolls through all of it
+
+// SSD1306 commands for the flush address window (horizontal addressing)
+#define OLED_CMD_ADDR_MODE   0x20
+#define OLED_ADDR_HORIZONTAL 0x00 // window wraps column then page
+#define OLED_CMD_COLUMN_ADDR 0x21
+#define OLED_CMD_PAGE_ADDR   0x22
+#define OLED_CMD_START_LINE  0x40 // | row shown at the top, 0 - 63
 
 /* FreeRTOS Defines -----------------------------------------*/
 #define OLEDTASK_STACK_SIZE		( configMINIMAL_STACK_SIZE * 2 )
-#define OLEDTASK_PRIORITY		( tskIDLE_PRIORITY + 5 ) // Higher priority due to latency
+#define OLEDTASK_PRIORITY		( tskIDLE_PRIORITY + 1 ) // transfers by DMA, waits without holding the CPU
+#define OLEDFLUSHTASK_STACK_SIZE	( configMINIMAL_STACK_SIZE )
+#define OLED_SWAP_POLL			2 // ticks between swap attempts while a frame waits
 
 
 // Define a queue message struct - STAGE 4
@@ -48,21 +129,39 @@ typedef struct {
     int cursorLocation;
 } OLED_Message;
 
-// Project queue mesage struct
-typedef struct {
-    char* string;
-    int cursorXLocation;
-    int cursorYLocation;
-    int z;
-    int angle;
+// Marker glyph drawn at the cursor - an index, never a pointer
+typedef enum {
+    OLED_MARKER_NONE = 0,
+    OLED_MARKER_CROSS,   // gantry position, '+'
+} OLED_Marker;
+
+// Project display state - copied by value into a one deep mailbox,
+// the sender overwrites and the OLED task renders only the newest
+typedef struct __attribute__((packed)) {
+    uint8_t marker;          // OLED_Marker
+    uint8_t cursorXLocation; // marker top left, pixels
+    uint8_t cursorYLocation;
+    uint8_t x;               // gantry position, workspace units - plot view
+    uint8_t y;
+    int16_t z;
+    int16_t angle;
+    uint8_t progress;        // predicted move progress 0-100, 100 = idle
 } OLED_ASCMessage;
 
-extern QueueHandle_t s4741858QueueOLEDMessage; // global define.
+// Event log line - copied by value, no pointers into the sender
+typedef struct {
+    char text[OLED_LOG_CHARS + 1];
+} OLED_LogLine;
+
+extern QueueHandle_t s4741858QueueOLEDMessage; // global define, latest state mailbox
+extern QueueHandle_t s4741858QueueOLEDLog;     // event log lines
 
 /* FUNCTIONS ---------------------------------------------------------*/
 void s4741858_reg_oled_init();
 void s4741858_reg_oled_asc_grid_init();
 void s4741858TaskOLEDControl( void ) ;
+void s4741858TaskOLEDFlush( void );
 extern void s4741858_tsk_oled_init();
+extern void s4741858_oled_log(const char *text);
 
 #endif
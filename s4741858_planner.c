@@ -0,0 +1,172 @@
+ /**
+ **************************************************************
+ * @file mylib/s4741858_planner.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Pick and place job planner - orders a list of jobs to
+ * minimise gantry travel over the ASC XY grid. No RTOS or HAL
+ * dependencies so it can be built and timed on a host.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_planner_order() - computes a near optimal job
+ * visiting order (nearest neighbour then 2-opt)
+ * s4741858_lib_planner_cost() - total travel of a given order
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "s4741858_planner.h"
+
+#define PLANNER_MAX_PASSES 8 // bounds 2-opt run time on the controller
+
+/*
+ * Travel between two grid points. X and Y axes move at the same
+ * time so the slower axis sets the time (Chebyshev distance).
+ */
+static uint16_t planner_dist(uint8_t ax, uint8_t ay, uint8_t bx, uint8_t by) {
+
+	uint16_t dx = (ax > bx) ? (ax - bx) : (bx - ax);
+	uint16_t dy = (ay > by) ? (ay - by) : (by - ay);
+
+	return (dx > dy) ? dx : dy;
+}
+
+/*
+ * Fills the link costs - travel from the place point of job a to the
+ * pick point of job b, and from the start point to each pick point.
+ */
+static void planner_links(const ASC_PlannerJobList *jobList, uint8_t startX, uint8_t startY,
+		uint16_t link[PLANNER_MAX_JOBS][PLANNER_MAX_JOBS], uint16_t startLink[PLANNER_MAX_JOBS]) {
+
+	const ASC_PlannerJob *jobs = jobList->jobs;
+
+	for (int a = 0; a < jobList->count; a++) {
+		startLink[a] = planner_dist(startX, startY, jobs[a].pickX, jobs[a].pickY);
+
+		for (int b = 0; b < jobList->count; b++) {
+			link[a][b] = planner_dist(jobs[a].placeX, jobs[a].placeY, jobs[b].pickX, jobs[b].pickY);
+		}
+	}
+}
+
+/*
+ * Cost of order[i..j] including the link into i and out of j.
+ * reversed = 1 evaluates the segment as if it was reversed.
+ */
+static uint32_t planner_segment(const uint8_t order[PLANNER_MAX_JOBS], int count, int i, int j, int reversed,
+		uint16_t link[PLANNER_MAX_JOBS][PLANNER_MAX_JOBS], uint16_t startLink[PLANNER_MAX_JOBS]) {
+
+	uint32_t cost = 0;
+	uint8_t first = reversed ? order[j] : order[i];
+	uint8_t last = reversed ? order[i] : order[j];
+
+	// link into the segment
+	cost += (i == 0) ? startLink[first] : link[order[i - 1]][first];
+
+	// links inside the segment
+	for (int k = i; k < j; k++) {
+		if (reversed) {
+			cost += link[order[k + 1]][order[k]];
+		} else {
+			cost += link[order[k]][order[k + 1]];
+		}
+	}
+
+	// link out of the segment
+	if (j < count - 1) {
+		cost += link[last][order[j + 1]];
+	}
+
+	return cost;
+}
+
+/**
+ * @brief Computes the job visiting order - nearest neighbour tour
+ * improved with 2-opt segment reversals until no gain (or pass limit).
+ * @param jobList jobs to order, count <= PLANNER_MAX_JOBS
+ * @param startX, startY current gantry position
+ * @param order output - job indexes in visiting order
+ * @return total XY travel of the returned order
+ */
+uint32_t s4741858_lib_planner_order(const ASC_PlannerJobList *jobList, uint8_t startX, uint8_t startY, uint8_t order[PLANNER_MAX_JOBS]) {
+
+	uint16_t link[PLANNER_MAX_JOBS][PLANNER_MAX_JOBS];
+	uint16_t startLink[PLANNER_MAX_JOBS];
+	uint32_t visited = 0;
+	int count = jobList->count;
+
+	if (count == 0) {
+		return 0;
+	}
+
+	planner_links(jobList, startX, startY, link, startLink);
+
+	// NEAREST NEIGHBOUR - greedy from current position
+	for (int n = 0; n < count; n++) {
+		int best = -1;
+		uint16_t bestCost = 0xFFFF;
+
+		for (int b = 0; b < count; b++) {
+			uint16_t cost = (n == 0) ? startLink[b] : link[order[n - 1]][b];
+
+			if (!(visited & (1 << b)) && (cost < bestCost)) {
+				bestCost = cost;
+				best = b;
+			}
+		}
+		order[n] = best;
+		visited |= (1 << best);
+	}
+
+	// 2-OPT - reverse any segment that shortens the tour
+	for (int pass = 0; pass < PLANNER_MAX_PASSES; pass++) {
+		int improved = 0;
+
+		for (int i = 0; i < count - 1; i++) {
+			for (int j = i + 1; j < count; j++) {
+
+				if (planner_segment(order, count, i, j, 1, link, startLink) <
+						planner_segment(order, count, i, j, 0, link, startLink)) {
+
+					for (int a = i, b = j; a < b; a++, b--) {
+						uint8_t swap = order[a];
+						order[a] = order[b];
+						order[b] = swap;
+					}
+					improved = 1;
+				}
+			}
+		}
+
+		if (!improved) {
+			break;
+		}
+	}
+
+	return s4741858_lib_planner_cost(jobList, startX, startY, order);
+}
+
+/**
+ * @brief Total XY travel for visiting the jobs in the given order,
+ * including the pick to place move of every job.
+ * @return travel in grid units
+ */
+uint32_t s4741858_lib_planner_cost(const ASC_PlannerJobList *jobList, uint8_t startX, uint8_t startY, const uint8_t order[PLANNER_MAX_JOBS]) {
+
+	const ASC_PlannerJob *jobs = jobList->jobs;
+	uint32_t cost = 0;
+	uint8_t x = startX;
+	uint8_t y = startY;
+
+	for (int n = 0; n < jobList->count; n++) {
+		const ASC_PlannerJob *job = &jobs[order[n]];
+
+		cost += planner_dist(x, y, job->pickX, job->pickY);
+		cost += planner_dist(job->pickX, job->pickY, job->placeX, job->placeY);
+		x = job->placeX;
+		y = job->placeY;
+	}
+
+	return cost;
+}
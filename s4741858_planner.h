@@ -0,0 +1,48 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+ /**
+ **************************************************************
+ * @file mylib/s4741858_planner.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Pick and place job planner - orders a list of jobs to
+ * minimise gantry travel over the ASC XY grid.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_planner_order() - computes a near optimal job
+ * visiting order (nearest neighbour then 2-opt)
+ * s4741858_lib_planner_cost() - total travel of a given order
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/* Planner Defines -----------------------------------------*/
+#define PLANNER_MAX_JOBS 16
+
+// Z heights used by the pick / place sequence
+#define PLANNER_Z_TRAVEL 90 // safe height for XY moves
+#define PLANNER_Z_PICK   0  // lowered onto part / bin
+
+// One job - move the part at the pick point to the place point
+typedef struct {
+    uint8_t pickX;
+    uint8_t pickY;
+    uint8_t placeX;
+    uint8_t placeY;
+} ASC_PlannerJob;
+
+// Job list submitted to the ASC controller as one message
+typedef struct {
+    uint8_t target; // rig to run on, row of the myconfig.h target table
+    uint8_t count;
+    ASC_PlannerJob jobs[PLANNER_MAX_JOBS];
+} ASC_PlannerJobList;
+
+/* .c File Functions -----------------------------------------*/
+extern uint32_t s4741858_lib_planner_order(const ASC_PlannerJobList *jobList, uint8_t startX, uint8_t startY, uint8_t order[PLANNER_MAX_JOBS]);
+extern uint32_t s4741858_lib_planner_cost(const ASC_PlannerJobList *jobList, uint8_t startX, uint8_t startY, const uint8_t order[PLANNER_MAX_JOBS]);
+
+#endif
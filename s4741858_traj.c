@@ -0,0 +1,238 @@
+ /**
+ **************************************************************
+ * @file mylib/s4741858_traj.c
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Trajectory generator - splits XYZ moves into waypoints
+ * on a trapezoidal velocity profile, with look-ahead so queued
+ * moves blend through their corners without stopping. All fixed
+ * point, no RTOS or HAL dependencies.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_traj_init() - empties the queue at a position
+ * s4741858_lib_traj_add() - queues a move, replans junctions
+ * s4741858_lib_traj_step() - advances one period, gives the
+ * next waypoint
+ * s4741858_lib_traj_idle() - 1 once every move is finished
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "s4741858_traj.h"
+#include "s4741858_motion.h"
+
+#define TRAJ_ACCEL_FIXED ((uint64_t) TRAJ_ACCEL * COORD_ONE)
+#define TRAJ_RAMP        ((uint32_t) ((TRAJ_ACCEL_FIXED * TRAJ_PERIOD_MS) / 1000)) // speed change per period
+
+static const uint32_t trajAxisSpeed[TRAJ_AXES] = {MOTION_X_SPEED, MOTION_Y_SPEED, MOTION_Z_SPEED};
+
+/*
+ * Integer square root, bit by bit.
+ */
+static uint32_t traj_sqrt(uint64_t value) {
+
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t) 1 << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (uint32_t) root;
+}
+
+static ASC_TrajSegment *traj_seg(ASC_Trajectory *traj, int n) {
+	return &traj->seg[(traj->head + n) % TRAJ_LOOKAHEAD];
+}
+
+/*
+ * Highest speed a move can leave at and still stop at v by the end
+ * of the following move of the given length.
+ */
+static uint32_t traj_reach(uint32_t v, uint32_t length) {
+	return traj_sqrt((uint64_t) v * v + 2 * TRAJ_ACCEL_FIXED * length);
+}
+
+/*
+ * Corner speed between two moves - full speed straight on, scaled by
+ * the cosine of the turn, zero at 90 degrees or sharper.
+ */
+static uint32_t traj_junction(const ASC_TrajSegment *a, const ASC_TrajSegment *b) {
+
+	int64_t dot = 0;
+	uint32_t vMax = (a->vMax < b->vMax) ? a->vMax : b->vMax;
+
+	for (int axis = 0; axis < TRAJ_AXES; axis++) {
+		dot += (int64_t) a->delta[axis] * b->delta[axis];
+	}
+
+	if (dot <= 0) {
+		return 0;
+	}
+
+	return (uint32_t) (((uint64_t) vMax * (uint64_t) dot) / ((uint64_t) a->length * b->length));
+}
+
+/*
+ * Backward pass over the queue - last move stops, every earlier one
+ * exits no faster than its corner allows or the next can brake from.
+ */
+static void traj_replan(ASC_Trajectory *traj) {
+
+	traj_seg(traj, traj->count - 1)->vExit = 0;
+
+	for (int n = traj->count - 2; n >= 0; n--) {
+		ASC_TrajSegment *a = traj_seg(traj, n);
+		ASC_TrajSegment *b = traj_seg(traj, n + 1);
+		uint32_t corner = traj_junction(a, b);
+		uint32_t reach = traj_reach(b->vExit, b->length);
+
+		a->vExit = (corner < reach) ? corner : reach;
+	}
+}
+
+/**
+ * @brief Empties the move queue, gantry at rest at the given position.
+ */
+void s4741858_lib_traj_init(ASC_Trajectory *traj, ASC_Coord x, ASC_Coord y, ASC_Coord z) {
+
+	traj->head = 0;
+	traj->count = 0;
+	traj->end[0] = x;
+	traj->end[1] = y;
+	traj->end[2] = z;
+	traj->progress = 0;
+	traj->speed = 0;
+}
+
+/**
+ * @brief Queues a straight move from the end of the last queued move
+ * and replans every junction in the queue. Zero length moves are dropped.
+ * @return 1 if queued (or dropped), 0 if the queue is full
+ */
+int s4741858_lib_traj_add(ASC_Trajectory *traj, ASC_Coord x, ASC_Coord y, ASC_Coord z) {
+
+	ASC_Coord target[TRAJ_AXES] = {x, y, z};
+	ASC_TrajSegment *seg;
+	uint64_t lengthSq = 0;
+
+	if (traj->count == TRAJ_LOOKAHEAD) {
+		return 0;
+	}
+
+	seg = traj_seg(traj, traj->count);
+
+	for (int axis = 0; axis < TRAJ_AXES; axis++) {
+		seg->start[axis] = traj->end[axis];
+		seg->delta[axis] = target[axis] - traj->end[axis];
+		lengthSq += (int64_t) seg->delta[axis] * seg->delta[axis];
+	}
+
+	seg->length = traj_sqrt(lengthSq);
+	if (seg->length == 0) {
+		return 1;
+	}
+
+	// Path speed where the first axis hits its own limit
+	seg->vMax = 0xFFFFFFFF;
+	for (int axis = 0; axis < TRAJ_AXES; axis++) {
+		uint32_t span = (seg->delta[axis] < 0) ? -seg->delta[axis] : seg->delta[axis];
+
+		if (span != 0) {
+			uint32_t limit = (uint32_t) (((uint64_t) trajAxisSpeed[axis] * COORD_ONE * seg->length) / span);
+			seg->vMax = (limit < seg->vMax) ? limit : seg->vMax;
+		}
+	}
+
+	for (int axis = 0; axis < TRAJ_AXES; axis++) {
+		traj->end[axis] = target[axis];
+	}
+	traj->count++;
+
+	traj_replan(traj);
+
+	return 1;
+}
+
+/**
+ * @brief Advances one TRAJ_PERIOD_MS - accelerates up to the move
+ * speed, brakes so the exit speed is met, carries into the next move.
+ * @param pos output - waypoint reached at the end of the period
+ * @return 1 if moving, 0 if idle (pos holds the final position)
+ */
+int s4741858_lib_traj_step(ASC_Trajectory *traj, ASC_Coord pos[TRAJ_AXES]) {
+
+	ASC_TrajSegment *seg;
+	uint32_t speed;
+	uint32_t limit;
+	uint32_t travel;
+	uint32_t brake;
+
+	if (traj->count == 0) {
+		for (int axis = 0; axis < TRAJ_AXES; axis++) {
+			pos[axis] = traj->end[axis];
+		}
+		return 0;
+	}
+
+	seg = traj_seg(traj, 0);
+
+	// TRAPEZOID - ramp up, cap at move speed, cap at braking curve
+	// Curve taken after this period's travel so corners are not overshot
+	speed = traj->speed + TRAJ_RAMP;
+	speed = (speed > seg->vMax) ? seg->vMax : speed;
+	brake = traj_reach(seg->vExit, seg->length - traj->progress);
+	limit = traj_sqrt((uint64_t) TRAJ_RAMP * TRAJ_RAMP + (uint64_t) brake * brake) - TRAJ_RAMP;
+	speed = (speed > limit) ? limit : speed;
+	traj->speed = speed;
+
+	travel = ((uint64_t) speed * TRAJ_PERIOD_MS) / 1000;
+
+	// Last period of a stop - land on the end rather than creep up to it
+	if ((seg->vExit == 0) && (limit <= TRAJ_RAMP)) {
+		travel = seg->length - traj->progress;
+	}
+	traj->progress += (travel == 0) ? 1 : travel; // never stall short of the end
+
+	// BLEND - leftover travel carries into the next move
+	while (traj->progress >= seg->length) {
+		traj->progress -= seg->length;
+		traj->speed = (traj->speed > seg->vExit) ? seg->vExit : traj->speed;
+		traj->head = (traj->head + 1) % TRAJ_LOOKAHEAD;
+		traj->count--;
+
+		if (traj->count == 0) {
+			traj->progress = 0;
+			traj->speed = 0;
+			for (int axis = 0; axis < TRAJ_AXES; axis++) {
+				pos[axis] = traj->end[axis];
+			}
+			return 1;
+		}
+		seg = traj_seg(traj, 0);
+	}
+
+	for (int axis = 0; axis < TRAJ_AXES; axis++) {
+		pos[axis] = seg->start[axis] + (ASC_Coord) (((int64_t) seg->delta[axis] * traj->progress) / seg->length);
+	}
+
+	return 1;
+}
+
+/**
+ * @brief 1 once the last queued move has been stepped to its end.
+ */
+int s4741858_lib_traj_idle(const ASC_Trajectory *traj) {
+	return traj->count == 0;
+}
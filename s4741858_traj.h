@@ -0,0 +1,58 @@
+#ifndef TRAJ_H
+#define TRAJ_H
+ /**
+ **************************************************************
+ * @file mylib/s4741858_traj.h
+ * @author flynn kelly - s4741858
+ * @date 19102026
+ * @brief Trajectory generator - splits XYZ moves into waypoints
+ * on a trapezoidal velocity profile, with look-ahead so queued
+ * moves blend through their corners without stopping.
+ ***************************************************************
+  * EXTERNAL FUNCTIONS
+ ***************************************************************
+ * s4741858_lib_traj_init() - empties the queue at a position
+ * s4741858_lib_traj_add() - queues a move, replans junctions
+ * s4741858_lib_traj_step() - advances one period, gives the
+ * next waypoint
+ * s4741858_lib_traj_idle() - 1 once every move is finished
+ ***************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "s4741858_coord.h"
+
+/* Profile Configuration ---------------------------------------------------------*/
+#define TRAJ_PERIOD_MS  100 // waypoint release period
+#define TRAJ_ACCEL      200 // units per second squared
+#define TRAJ_LOOKAHEAD  4   // queued moves planned together
+
+#define TRAJ_AXES 3 // x, y, z - angle is not interpolated
+
+// One straight move - speeds in fixed point units per second
+typedef struct {
+    ASC_Coord start[TRAJ_AXES];
+    ASC_Coord delta[TRAJ_AXES];
+    uint32_t length; // fixed point units
+    uint32_t vMax;   // slowest axis at its MOTION_*_SPEED
+    uint32_t vExit;  // planned speed at the junction with the next move
+} ASC_TrajSegment;
+
+// Move queue and the point currently reached
+typedef struct {
+    ASC_TrajSegment seg[TRAJ_LOOKAHEAD];
+    uint8_t head;
+    uint8_t count;
+    ASC_Coord end[TRAJ_AXES]; // end of last queued move
+    uint32_t progress;        // along the head move
+    uint32_t speed;
+} ASC_Trajectory;
+
+/* .c File Functions -----------------------------------------*/
+extern void s4741858_lib_traj_init(ASC_Trajectory *traj, ASC_Coord x, ASC_Coord y, ASC_Coord z);
+extern int s4741858_lib_traj_add(ASC_Trajectory *traj, ASC_Coord x, ASC_Coord y, ASC_Coord z);
+extern int s4741858_lib_traj_step(ASC_Trajectory *traj, ASC_Coord pos[TRAJ_AXES]);
+extern int s4741858_lib_traj_idle(const ASC_Trajectory *traj);
+
+#endif
@@ -11,13 +11,60 @@
 
 /* INCLUDES ----------------------------------------------------------*/
 #include "s4741858_txradio.h"
+#include "s4741858_diag.h"
+#include "s4741858_oled.h"
+#include "myconfig.h"
+#include <string.h>
 
 #ifdef FreeRTOS
 /* RTOS Structures (defined in .h) ----------------------------*/
 QueueHandle_t s4741858QueueRadioTXMessage; // event group flags - mapping in .h
+QueueHandle_t s4741858QueueRadioTXTarget[RADIO_MAX_TARGETS];
 SemaphoreHandle_t s4741858SemaphorePBSig;
+
+#if !configUSE_QUEUE_SETS
+#error "txradio needs configUSE_QUEUE_SETS 1 in FreeRTOSConfig.h"
+#endif
+static QueueSetHandle_t radioWakeSet; // PB semaphore and every rig queue - one wait for all
 #endif
 
+/* TARGET TABLE ----------------------------------------------*/
+typedef struct {
+  uint8_t channel;
+  uint8_t address[5];
+  uint8_t weight;
+} TXRadio_Target;
+
+#define RADIO_ADDR_BYTES(...) __VA_ARGS__ // strips the brackets round a table address
+#define RADIO_TARGET_ROW(chan, addr, w) {chan, {RADIO_ADDR_BYTES addr}, w},
+
+uint8_t myradiotxaddr[5] = {MYRADIOADDR}; // rig 0, table row 0 is built from the same bytes
+
+static const TXRadio_Target radioTargets[] = {
+  MYRADIO_TARGET_TABLE(RADIO_TARGET_ROW)
+};
+
+#define RADIO_TABLE_ROWS ((int) (sizeof(radioTargets) / sizeof(radioTargets[0])))
+#define RADIO_TARGETS    ((RADIO_TABLE_ROWS < RADIO_MAX_TARGETS) ? RADIO_TABLE_ROWS : RADIO_MAX_TARGETS)
+
+/* SCHEDULER VARIABLES ----------------------------------------------*/
+static int radioTurn = 0;   // target holding the current round
+static int radioCredit = 0; // packets it may still send this round
+static int radioSelected = -1; // target the nrf is addressed to
+static TXRadio_LinkStats linkStats[RADIO_MAX_TARGETS];
+
+/* TIME SYNC VARIABLES ----------------------------------------------*/
+static volatile uint32_t timeSynced = 0; // bit per target, set once JOIN carrying tick is sent - not acknowledged
+static uint32_t lastSyncTick[RADIO_MAX_TARGETS];
+
+static int txradio_pending(void);
+static int txradio_schedule(void);
+static int txradio_sync_due(void);
+static TickType_t txradio_sync_wait(void);
+static void txradio_sync_packet(uint8_t *packet, uint8_t type, const char *tag);
+static void txradio_select(int target);
+static void txradio_encode(const uint8_t *packet, uint8_t *encoded, int first, int count);
+
 /* FreeRTOS CODE-----------------------------------------------------*/
 
 #ifdef FreeRTOS
@@ -62,15 +109,34 @@ void s4741858TaskTxradioControl( void ) {
   nrf24l01plus_init();
   s4741858_reg_board_hardware_init();
   s4741858_reg_board_pb_init(); // NEED ENTER CRITICAL??
-  // init the channel myconfig.h!!
+  // channel and address come from myconfig.h, set per rig by txradio_select()
 
   // QUEUE MESSAGE
-  uint8_t ReceiveRadioPacket[TASK_RADIO_PACKET_SIZE];
+  TXRadio_QueueItem ReceiveRadioPacket;
+  uint32_t keyTick = 0; // key behind the packet in the buffers
+  uint8_t followPacket[TASK_RADIO_PACKET_SIZE]; // command whose EXEC is in the buffers
+  int followPending = 0;
+
+  // Create Queues - one per rig, target 0 keeps the original handle. Each
+  // joins the wake set while still empty, before a producer can see it
+  QueueSetMemberHandle_t wakeHandle;
+  SemaphoreHandle_t pbSig = xSemaphoreCreateBinary();
+
+  radioWakeSet = xQueueCreateSet((RADIO_TARGETS * RADIO_QUEUE_LENGTH) + 1);
+  xQueueAddToSet(pbSig, radioWakeSet);
+  s4741858SemaphorePBSig = pbSig;
+
+  for (int i = 0; i < RADIO_TARGETS; i++) {
+    QueueHandle_t queue = xQueueCreate(RADIO_QUEUE_LENGTH, sizeof(ReceiveRadioPacket));
+
+    xQueueAddToSet(queue, radioWakeSet);
+    s4741858QueueRadioTXTarget[i] = queue;
+  }
+  s4741858QueueRadioTXMessage = s4741858QueueRadioTXTarget[0];
+  uint32_t joinPending = 0; // bit per target still to be sent a JOIN
+  int target = 0; // rig the packet in the buffers is for
 
-  // Create Queue
-  s4741858QueueRadioTXMessage = xQueueCreate(10, sizeof(ReceiveRadioPacket));	
-  s4741858SemaphorePBSig = xSemaphoreCreateBinary();
-  uint8_t pbPressed = 0;
+  txradio_select(0); // default rig until something else is queued
 
   // enter loop - FSM for radio
   static int RadioFSMCurrentState = INIT_STATE;
@@ -96,79 +162,113 @@ void s4741858TaskTxradioControl( void ) {
       // Essentially Waits for Board PB or Button Press
       case IDLE_STATE:
 
-        // BOARD PB 
-        if (s4741858SemaphorePBSig != NULL) {
-          
-          // SEND JOIN MESSAGE
-          if (xSemaphoreTake( s4741858SemaphorePBSig, 10 ) == pdTRUE ) {
-            
-            // TOGGLE LED - GETS HERE
-            BRD_LEDBlueToggle(); // Toggled here due to semaphore
-            
-            // SET UNENCODED BYTE
-            global_packet_unencoded[0] = 0x20; // JOIN TYPE
-            global_packet_unencoded[1] = 0x47; // SENDER ADDRESS
-            global_packet_unencoded[2] = 0x41;
-            global_packet_unencoded[3] = 0x85;
-            global_packet_unencoded[4] = 0x89;
-            global_packet_unencoded[5] = 'J'; // JOIN MESSAGE - chars ASCII cast
-            global_packet_unencoded[6] = 'O';
-            global_packet_unencoded[7] = 'I';
-            global_packet_unencoded[8] = 'N';
-
-            pbPressed = 1;
-            // Progress to Hamming
-            nextState = ENCODE_STATE;
-  
-          } else {
-            nextState = IDLE_STATE;
-            pbPressed = 0;
-          }
+        nextState = IDLE_STATE;
+
+        // WAIT - sleeps until the PB, a queued packet or the next SYNC is due.
+        // Peek leaves the set alone, one handle is taken per event handled
+        // below so the set always counts what is waiting
+        if ((joinPending == 0) && !txradio_pending()) {
+          xQueuePeek((QueueHandle_t) radioWakeSet, &wakeHandle, txradio_sync_wait());
         }
 
-        if (s4741858QueueRadioTXMessage != NULL) {
+        // BOARD PB - JOIN goes to every rig
+        if (xSemaphoreTake( s4741858SemaphorePBSig, 0 ) == pdTRUE ) {
+          xQueueSelectFromSet(radioWakeSet, 0);
+
+          // TOGGLE LED - GETS HERE
+          BRD_LEDBlueToggle(); // Toggled here due to semaphore
+          joinPending = (1 << RADIO_TARGETS) - 1;
+        }
+
+        if (joinPending != 0) {
+
+          // SEND JOIN MESSAGE - controller tick stamped in TRANSMIT_STATE, just before air
+          target = __builtin_ctz(joinPending);
+          joinPending &= joinPending - 1;
+          txradio_sync_packet(global_packet_unencoded, JOIN_TYPE, "JOIN");
+          keyTick = 0;
+          nextState = ENCODE_STATE;
 
+        } else if ((target = txradio_schedule()) >= 0) {
 
-          if (xQueueReceive(s4741858QueueRadioTXMessage, &ReceiveRadioPacket, 10 )) {
-          
-            // Store the unencoded radio packet in the global variable
-            for (int i = 0; i < TASK_RADIO_PACKET_SIZE; i++) {
-              global_packet_unencoded[i] = ReceiveRadioPacket[i];
+          // WEIGHTED ROUND ROBIN - next packet from the rig holding the turn
+          uint8_t depth = uxQueueMessagesWaiting(s4741858QueueRadioTXTarget[target]);
+
+          if (depth > linkStats[target].maxDepth) {
+            linkStats[target].maxDepth = depth;
+          }
+          if (xQueueReceive(s4741858QueueRadioTXTarget[target], &ReceiveRadioPacket, 0)) {
+            xQueueSelectFromSet(radioWakeSet, 0);
+
+            // Store the unencoded radio packet in the global variable - EXEC
+            // first, its command follows straight after it is sent
+            if (ReceiveRadioPacket.exec[0] == EXEC_TYPE) {
+              memcpy(global_packet_unencoded, ReceiveRadioPacket.exec, TASK_RADIO_PACKET_SIZE);
+              memcpy(followPacket, ReceiveRadioPacket.packet, TASK_RADIO_PACKET_SIZE);
+              followPending = 1;
+            } else {
+              memcpy(global_packet_unencoded, ReceiveRadioPacket.packet, TASK_RADIO_PACKET_SIZE);
             }
-            
-           // nrf24l01plus_send(global_packet_unencoded); // send unencoded - testing
-            
+            keyTick = ReceiveRadioPacket.keyTick;
             nextState = ENCODE_STATE; 
-          } else if (pbPressed == 0) { // ELSE IF PUSHBUTTON SEMAPHORE FLAG - looping to IDLE
-            nextState = IDLE_STATE;
           }
 
-          //nextState = IDLE_STATE; // stay waiting for message
+        } else if ((target = txradio_sync_due()) >= 0) {
 
+          // PERIODIC RE-SYNC - keeps gantry clock offset from drifting
+          txradio_sync_packet(global_packet_unencoded, SYNC_TYPE, "SYNC");
+          keyTick = 0;
+          nextState = ENCODE_STATE;
         }
         break;
       
       case ENCODE_STATE: // gets here if queue received
 
-        // DO THE HAMMING ENCODING
-                    // loop over each byte in the input packet and encode it with Hamming code
-        for (int i = 0; i < TASK_RADIO_PACKET_SIZE; i++) {
-          uint16_t encoded_byte =
-              s4741858_lib_hamming_byte_encoder(global_packet_unencoded[i]);
-
-          // copy the two bytes of the encoded byte into the output packet
-          global_packet_encoded[i * 2] = encoded_byte & 0xFF;
-          global_packet_encoded[i * 2 + 1] = (encoded_byte >> 8) & 0xFF;
-          
-        
-        }
+        // DO THE HAMMING ENCODING - JOIN / SYNC tick bytes redone at transmit
+        txradio_encode(global_packet_unencoded, global_packet_encoded, 0, TASK_RADIO_PACKET_SIZE);
 
         nextState = TRANSMIT_STATE;
         break;
       
       case TRANSMIT_STATE:
 
+        txradio_select(target); // re-address only when the rig changes
+
+        // TIME SYNC - stamped right before the send so only air time is unknown
+        if ((global_packet_unencoded[0] == JOIN_TYPE) || (global_packet_unencoded[0] == SYNC_TYPE)) {
+          lastSyncTick[target] = HAL_GetTick();
+          s4741858_txradio_put_tick(global_packet_unencoded, lastSyncTick[target]);
+          txradio_encode(global_packet_unencoded, global_packet_encoded, RADIO_TIMESTAMP_INDEX, 4);
+        }
+
         nrf24l01plus_send(global_packet_encoded); // sends encoded -
+        linkStats[target].packets++;
+        linkStats[target].lastTick = HAL_GetTick();
+        if (keyTick != 0) {
+          s4741858_diag_latency(linkStats[target].lastTick - keyTick); // keypress to air
+          keyTick = 0;
+        }
+
+        if ((global_packet_unencoded[0] == JOIN_TYPE) || (global_packet_unencoded[0] == SYNC_TYPE)) {
+          timeSynced |= 1 << target;
+          linkStats[target].syncs++;
+
+          if (global_packet_unencoded[0] == JOIN_TYPE) {
+            char line[OLED_LOG_CHARS + 1];
+
+            snprintf(line, sizeof(line), "R%d JOIN ch %d", target, radioTargets[target].channel);
+            s4741858_oled_log(line);
+          }
+        }
+
+        // EXEC SENT - its command goes next, same rig, before anything else
+        if (followPending) {
+          memcpy(global_packet_unencoded, followPacket, TASK_RADIO_PACKET_SIZE);
+          followPending = 0;
+          nextState = ENCODE_STATE;
+          break;
+        }
+
         // RESET BUFFERS TO ZERO - FUNCTION!!!
         nextState = IDLE_STATE; 
         break;
@@ -187,3 +287,164 @@ void s4741858TaskTxradioControl( void ) {
 
 
 #endif
+
+/**
+ * @brief 1 if any rig has a packet waiting - INTERNAL
+ */
+static int txradio_pending(void) {
+
+  for (int i = 0; i < RADIO_TARGETS; i++) {
+    if ((s4741858QueueRadioTXTarget[i] != NULL) && (uxQueueMessagesWaiting(s4741858QueueRadioTXTarget[i]) != 0)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Picks the rig to send the next packet to - the turn holder keeps
+ * sending until its weight is used up or its queue is empty, then the
+ * turn moves on. Rigs with nothing queued are skipped. - INTERNAL
+ * @return target, -1 if every queue is empty
+ */
+static int txradio_schedule(void) {
+
+  for (int n = 0; n <= RADIO_TARGETS; n++) {
+    if ((radioCredit != 0) && (s4741858QueueRadioTXTarget[radioTurn] != NULL) &&
+        (uxQueueMessagesWaiting(s4741858QueueRadioTXTarget[radioTurn]) != 0)) {
+      radioCredit--;
+      return radioTurn;
+    }
+    radioTurn = (radioTurn + 1) % RADIO_TARGETS;
+    radioCredit = radioTargets[radioTurn].weight;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Finds a joined rig whose clock has not been re-synced for
+ * TIME_SYNC_PERIOD - INTERNAL
+ * @return target, -1 if none due
+ */
+static int txradio_sync_due(void) {
+
+  for (int i = 0; i < RADIO_TARGETS; i++) {
+    if ((timeSynced & (1 << i)) && (HAL_GetTick() - lastSyncTick[i] >= TIME_SYNC_PERIOD)) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Time until the next SYNC falls due, the longest IDLE_STATE
+ * may sleep - INTERNAL
+ * @return ticks, portMAX_DELAY if no rig has joined
+ */
+static TickType_t txradio_sync_wait(void) {
+
+  TickType_t wait = portMAX_DELAY;
+  uint32_t now = HAL_GetTick();
+
+  for (int i = 0; i < RADIO_TARGETS; i++) {
+    if (timeSynced & (1 << i)) {
+      uint32_t elapsed = now - lastSyncTick[i];
+      TickType_t left = (elapsed >= TIME_SYNC_PERIOD) ? 0 : pdMS_TO_TICKS(TIME_SYNC_PERIOD - elapsed);
+
+      wait = (left < wait) ? left : wait;
+    }
+  }
+
+  return wait;
+}
+
+/**
+ * @brief Fills a JOIN / SYNC packet - type, sender, 4 char tag. The tick
+ * is stamped in TRANSMIT_STATE - INTERNAL
+ */
+static void txradio_sync_packet(uint8_t *packet, uint8_t type, const char *tag) {
+
+  memset(packet, 0, TASK_RADIO_PACKET_SIZE);
+  packet[0] = type;
+  packet[1] = 0x47; // SENDER ADDRESS
+  packet[2] = 0x41;
+  packet[3] = 0x85;
+  packet[4] = 0x89;
+  memcpy(&packet[5], tag, 4); // chars ASCII
+
+}
+
+/**
+ * @brief Hamming encodes count packet bytes from first - every byte is
+ * two in the encoded frame - INTERNAL
+ */
+static void txradio_encode(const uint8_t *packet, uint8_t *encoded, int first, int count) {
+
+  for (int i = first; i < first + count; i++) {
+    uint16_t encoded_byte = s4741858_lib_hamming_byte_encoder(packet[i]);
+
+    // copy the two bytes of the encoded byte into the output packet
+    encoded[i * 2] = encoded_byte & 0xFF;
+    encoded[i * 2 + 1] = (encoded_byte >> 8) & 0xFF;
+  }
+
+}
+
+/**
+ * @brief Points the nrf at a rig - channel and TX address (pipe 0 too so
+ * auto-ack is heard). Skipped when already addressed there - INTERNAL
+ */
+static void txradio_select(int target) {
+
+  if (target == radioSelected) {
+    return;
+  }
+
+  nrf24l01plus_wr(NRF24L01P_WRITE_REG | NRF24L01P_RF_CH, radioTargets[target].channel);
+  nrf24l01plus_wb(NRF24L01P_WRITE_REG | NRF24L01P_TX_ADDR, (uint8_t *) radioTargets[target].address, 5);
+  nrf24l01plus_wb(NRF24L01P_WRITE_REG | NRF24L01P_RX_ADDR_P0, (uint8_t *) radioTargets[target].address, 5);
+  radioSelected = target;
+
+}
+
+/**
+ * @brief Returns whether a rig has been sent the controller clock,
+ * ie. execute-at ticks can be used.
+ * @return 1 once a JOIN with timestamp has gone to air for the target
+ */
+extern int s4741858_txradio_time_synced(int target) {
+  return (timeSynced >> target) & 1;
+}
+
+/**
+ * @brief Number of rigs in the myconfig.h target table.
+ */
+extern int s4741858_txradio_targets(void) {
+  return RADIO_TARGETS;
+}
+
+/**
+ * @brief Copies the link statistics of one rig.
+ */
+extern void s4741858_txradio_link_stats(int target, TXRadio_LinkStats *stats) {
+
+  if ((target >= 0) && (target < RADIO_TARGETS)) {
+    *stats = linkStats[target];
+  }
+
+}
+
+/**
+ * @brief Writes a controller tick into a packet at RADIO_TIMESTAMP_INDEX,
+ * little endian.
+ */
+void s4741858_txradio_put_tick(uint8_t *packet, uint32_t tick) {
+
+  for (int i = 0; i < 4; i++) {
+    packet[RADIO_TIMESTAMP_INDEX + i] = (tick >> (8 * i)) & 0xFF;
+  }
+
+}
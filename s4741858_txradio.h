@@ -50,7 +50,46 @@
 #define TASK_RADIO_PACKET_SIZE 16 // change accordingly
 #define ENCODED_RADIO_PACKET_SIZE 32 // hamming encoded
 
-extern QueueHandle_t s4741858QueueRadioTXMessage; // global define.
+// Radio queue item - packet plus the key press that caused it. A
+// scheduled command carries its EXEC packet in the same item, so the
+// pair leaves the queue together and nothing is sent in between
+typedef struct {
+    uint8_t exec[TASK_RADIO_PACKET_SIZE]; // EXEC_TYPE packet sent just before packet, exec[0] = 0 if none
+    uint8_t packet[TASK_RADIO_PACKET_SIZE];
+    uint32_t keyTick; // key edge tick for keypress to air latency, 0 = not a key
+} TXRadio_QueueItem;
+
+extern QueueHandle_t s4741858QueueRadioTXMessage; // global define - target 0 queue
+
+/* Multiple Gantries -----------------------------------------*/
+#define RADIO_MAX_TARGETS  4  // rigs in myconfig.h MYRADIO_TARGET_TABLE, at most
+#define RADIO_QUEUE_LENGTH 10 // packets waiting per target
+
+extern QueueHandle_t s4741858QueueRadioTXTarget[RADIO_MAX_TARGETS]; // one queue per rig
+
+// Link statistics kept per target
+typedef struct {
+    uint32_t packets;  // frames sent to air
+    uint32_t syncs;    // JOIN / SYNC frames among them
+    uint32_t lastTick; // tick of the last frame
+    uint8_t maxDepth;  // deepest the queue has been
+} TXRadio_LinkStats;
+
+/* Time Sync -----------------------------------------*/
+// One way - the radio is TX only, so there is no handshake. The
+// controller broadcasts its tick and the gantry takes it as now.
+// The stamp is taken after the nrf is addressed, just before the
+// send, so the gantry lags by the SPI load + air time + its RX
+// handling, a few ms, always late and never early. Nothing confirms
+// the JOIN landed - "synced" means sent, and a lost JOIN / SYNC
+// leaves that rig stale until the next SYNC, TIME_SYNC_PERIOD later.
+// EXEC ticks go out at least MOTION_RELEASE_LEAD_MS ahead to cover the lag
+#define JOIN_TYPE 0x20 // JOIN + controller tick
+#define SYNC_TYPE 0x21 // periodic re-sync, same layout as JOIN
+#define EXEC_TYPE 0x25 // execute-at tick for the next command packet
+
+#define RADIO_TIMESTAMP_INDEX 9      // 4 byte little endian tick after 4 char tag
+#define TIME_SYNC_PERIOD      2000   // ms between SYNC packets once joined
 
 /* State Enumerating -----------------------------------------*/
 #define INIT_STATE 0
@@ -63,5 +102,9 @@ extern QueueHandle_t s4741858QueueRadioTXMessage; // global define.
 extern void s4741858_tsk_txradio_init();
 void s4741858TaskTxradioControl( void );
 void s4741858_reg_board_hardware_init();
+extern int s4741858_txradio_time_synced(int target);
+extern int s4741858_txradio_targets(void);
+extern void s4741858_txradio_link_stats(int target, TXRadio_LinkStats *stats);
+void s4741858_txradio_put_tick(uint8_t *packet, uint32_t tick);
 
 #endif